@@ -10,456 +10,3671 @@
  *
  * Notes: Use RR with a time slice of 1 quantum.
  *
+ * Closed-loop mode (--closed-loop): a completing process can resubmit itself after a
+ * think time and/or spawn follow-up children. Future arrivals live in a hierarchical
+ * timing wheel instead of the pre-sorted arrival list.
+ *
+ * Cluster mode (--nodes=N): one simulation of N nodes, each with its own HPF scheduler,
+ * partitioned across --threads=T worker threads. Closed-loop follow-ups may migrate to
+ * another node; they take --migration-delay quanta to get there, which is also the
+ * lookahead for the conservative time-window protocol. --threads=1 is the sequential
+ * engine and produces the same schedule for any thread count.
+ *
+ * I/O mode (--io): processes alternate CPU and I/O bursts. An I/O burst is a request to
+ * one of the simulated devices (FIFO, --io-service time per request); the process sits in
+ * a blocked heap ordered by wakeup time until it completes. The same workload is run
+ * preemptive and non-preemptive to compare CPU utilization and CPU/I-O overlap.
+ *
+ * Adaptive mode (--adaptive): independent Monte Carlo trials run on --threads workers in
+ * batches until every --metrics value, for every priority, has a 95% confidence interval
+ * half-width within --precision of its mean, or --max-trials is reached.
+ *
+ * Lock mode (--locks=N): a share of the processes take one of N simulated mutexes part way
+ * through their run and hold it for a while; others wanting it wait in the lock's queue.
+ * The same workload is run with no protocol, priority inheritance and priority ceiling,
+ * reporting blocked time and priority inversion per priority. Inversion is the part of the
+ * blocked time during which the CPU ran at a lower effective priority than the waiter, so
+ * a holder boosted by the protocol doesn't count.
+ *
+ * CFS (--policy=cfs): instead of HPF, a completely fair policy. Every process accrues
+ * virtual runtime at a rate inversely proportional to its priority's weight; the runnable
+ * set is a red-black tree ordered by vruntime and the leftmost process runs for a slice of
+ * --target-latency shared by weight, never less than --min-granularity. --cfs-compare runs
+ * HPF and CFS on the same workload; --cfs-bench=N times dispatch with up to N runnable.
+ *
+ * Admission control (--admission=cap,wait,bucket): arrivals are checked before they join a
+ * ready queue. A priority's queue-length cap or estimated-wait limit rejects the process
+ * outright; its token bucket defers it until a token is due. --processes=N overloads the
+ * CPU and --admission-compare runs the same workload under each policy, reporting p99
+ * waiting time per priority next to what was rejected or deferred.
+ *
+ * Server mode (--serve=PATH): a long-lived process answering simulation requests on a Unix
+ * socket, one key=value line in, one JSON line out, on --threads warm workers that reuse
+ * their node between requests. Saves process startup for tools that run thousands of
+ * small simulations; see hpf_serve() for the request keys.
+ *
+ * Timeline (--timeline=FILE): the schedule as Gantt segments instead of one log line per
+ * quantum. Consecutive quanta of the same process are one [start, end) segment with the
+ * reason it ended (complete, io, preempt, slice, lock). Cluster mode gets one lane per node
+ * and the comparison modes one lane per run, in table order. --timeline-binary writes
+ * varint records instead of text (see writeTimeline()).
+ *
+ * Build: cc -O2 -pthread hpf_pre.c -lm
+ * Library: see hpf_sim.h
+ *
  * Written by: Raphael Kusuma -- 10/11/2025
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "hpf_sim.h"
+
+// The library's types go by their short names in here
+typedef hpf_process process;
+typedef hpf_stats stats;
+typedef hpf_priority_stats priority_stats;
+typedef hpf_workload_config workload_config;
+typedef hpf_io_config io_config;
+typedef hpf_lock_config lock_config;
+typedef hpf_cfs_config cfs_config;
+typedef hpf_admission_config admission_config;
 
 #define NUM_PROCESSES 26
 #define MAX_QUANTA 100
+// Process table slots per generated process, the rest is room for closed-loop follow-ups
+#define PROCESS_POOL_FACTOR 8
+
+// Timing wheel: 2 levels of 64 slots, 1 quantum per level-0 slot (4096 quanta horizon)
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+
+#define MAX_DEVICES 8
+#define MAX_LOCKS 8
+
+// process.lockState
+#define LOCK_NOT_TAKEN 0
+#define LOCK_HOLDING 1
+#define LOCK_RELEASED 2
+
+// Only the single node run prints the per-quantum log
+#define LOG(node, ...)          \
+  do                            \
+  {                             \
+    if ((node)->verbose)        \
+      printf(__VA_ARGS__);      \
+  } while (0)
 
 // For the sake of not having multiple header files, I'm gonna have this large C file.
-typedef struct process
-{
-  // int processId;
-  char processName;
-  float arrivalTime;
-  float expectedRunTime;
-  float remainingTime;
-  int priority;
-  // When a process starts and finished
-  float startTime;
-  float finishTime;
-
-  // It is equal to the sum total of Waiting time and Execution time.
-  float turnaroundTime;
-  float waitingTime;
-  int timesPreempted;
-} process;
+// Only the structs the library API hands out live in hpf_sim.h.
 
 // pqueue
 typedef struct pqueue
 {
-  process *processes[NUM_PROCESSES];
+  process **processes;
+  int capacity;
   int front;
   int rear;
   int count;
+  double work; // sum of the queued processes' remainingTime
 } pqueue;
 
-// Stats
-typedef struct stats
+// Cluster mode knobs
+typedef struct cluster_config
+{
+  int numNodes;
+  int numThreads;
+  int jobsPerNode;
+  int migrationDelay;       // quanta for a job to reach another node, also the lookahead
+  float migrateProbability; // chance a closed-loop follow-up goes to another node
+} cluster_config;
+
+// A single-server FIFO device. Requests queue behind busyUntil.
+typedef struct io_device
+{
+  float busyUntil;
+  float busyTime;
+  float queueingDelay; // total time requests waited before service
+  int requests;
+} io_device;
+
+// Processes blocked on I/O, min-heap on wakeupTime
+typedef struct blocked_heap
+{
+  process **processes;
+  int count;
+} blocked_heap;
+
+// CFS runqueue: red-black tree on (vruntime, processId), leftmost cached for O(1) pick
+typedef struct cfs_tree
+{
+  process *root;
+  process *leftmost;
+  int count;
+  long totalWeight;
+  int queued[4]; // runnable processes per (base) priority
+  double work;   // sum of the queued processes' remainingTime
+} cfs_tree;
+
+// A simulated mutex. Waiters are kept in arrival order; the best priority goes first.
+typedef struct sim_lock
+{
+  process *holder;
+  process **waiters;
+  int numWaiters;
+  int ceiling; // highest priority (lowest number) of any process using the lock
+} sim_lock;
+
+// A FIFO list of processes due in the same slot
+typedef struct timer_slot
+{
+  process *head;
+  process *tail;
+} timer_slot;
+
+// Hierarchical timing wheel of future arrivals. Level 0 holds the next 64 quanta, level 1
+// holds the following 64 blocks of 64 quanta and is cascaded into level 0 a block at a time.
+// Anything further out waits in the overflow list until level 1 wraps.
+typedef struct timing_wheel
+{
+  timer_slot level0[WHEEL_SIZE];
+  timer_slot level1[WHEEL_SIZE];
+  timer_slot overflow;
+  int now;     // every arrival due before this tick has been expired
+  int pending; // arrivals still in the wheel
+} timing_wheel;
+
+// A follow-up job on its way to another node
+typedef struct migration
+{
+  int dstNode;
+  int srcNode;
+  int seq; // per source node, fixes the delivery order independently of the thread count
+  int parentId;
+  char processName;
+  int priority;
+  int resubmitsLeft;
+  float arrivalTime;
+  float expectedRunTime;
+} migration;
+
+typedef struct migration_list
+{
+  migration *items;
+  int count;
+  int capacity;
+} migration_list;
+
+// Why a timeline segment ended
+#define SEGMENT_END 0      // still running when the simulation stopped
+#define SEGMENT_COMPLETE 1
+#define SEGMENT_IO 2       // blocked on an I/O burst
+#define SEGMENT_PREEMPT 3  // a higher priority process took the CPU
+#define SEGMENT_SLICE 4    // quantum / CFS slice used up, someone else's turn
+#define SEGMENT_LOCK 5     // blocked on a lock held by another process
+
+// One CPU's schedule as run-length-encoded segments: consecutive quanta of the same
+// process are one [start, end) segment, encoded (text or binary) when it closes
+typedef struct timeline_lane
+{
+  unsigned char *data;
+  size_t length;
+  size_t capacity;
+  int segments;
+  int lastEnd; // binary: start is stored as the gap since the previous segment
+
+  // The open segment
+  process *p;
+  int start;
+  int end;
+  int reason;
+} timeline_lane;
+
+// A node's copy of the process-wide knobs (hpf_sim.h), clamped when the node is set up
+typedef struct sim_config
+{
+  workload_config workload;
+  io_config io;
+  lock_config locks;
+  cfs_config cfs;
+  admission_config admission;
+} sim_config;
+
+// Everything one scheduler (one CPU) needs. A plain run is a single node.
+typedef struct sim_node
+{
+  int nodeId;
+  sim_config config; // locks.numLocks also sizes the lock waiter arrays
+  process *processList;
+  int numProcesses;
+  int maxProcesses;
+
+  pqueue priorityQueues[4];
+  timing_wheel arrivalWheel;
+  blocked_heap blocked;
+  io_device devices[MAX_DEVICES];
+  sim_lock locks[MAX_LOCKS];
+  int lockProtocol;
+  cfs_tree cfs;
+  double minVruntime; // never goes backwards; new and woken processes start here
+  float sliceLeft;    // CFS: what is left of the running process's slice
+  int admissionPolicies; // ADMISSION_* bits
+  float tokens[4];       // token bucket level per priority, as of tokensAt
+  int tokensAt[4];
+  process *currentProcess;
+  int currentTime;
+  int idleTime;
+  int totalPreemptions;
+  int policy; // HPF_POLICY_*. Non-preemptive keeps the CPU until its burst ends (FCFS within a level)
+
+  // CPU / I-O accounting, in quanta
+  int cpuBusyTime;
+  int deviceBusyTime; // quanta in which at least one device was busy
+  int overlapTime;    // ... and the CPU was busy as well
+
+  unsigned int rngState;
+  int verbose;
+
+  int resubmittedProcesses;
+  int spawnedProcesses;
+  int droppedProcesses; // closed-loop arrivals lost to a full processList
+  int cutOffProcesses;  // ... and follow-ups that would arrive after MAX_QUANTA
+  int migratedOut;
+  int migratedIn;
+  int migrationSeq;
+  migration_list *outbox; // cross-node follow-ups, NULL outside cluster mode
+  timeline_lane *timeline; // Gantt segments, NULL unless --timeline
+} sim_node;
+
+workload_config hpf_workload = {0, 3, 1.0f, 10.0f, 0.0f, 2};
+static cluster_config clusterConfig = {1, 1, NUM_PROCESSES, 4, 0.25f};
+io_config hpf_io = {0, 3, 0.5f, 4.0f, 1};
+lock_config hpf_locks = {0, LOCK_PROTOCOL_INHERIT, 0.5f, 0.2f, 3.0f};
+cfs_config hpf_cfs = {6.0f, 1.0f};
+admission_config hpf_admission = {0, {3, 3, 3, 2}, {5.0f, 10.0f, 20.0f, 30.0f},
+                                  {0.1f, 0.06f, 0.04f, 0.02f}, {3.0f, 2.0f, 2.0f, 1.0f}};
+
+// --timeline output: one lane per node (cluster mode) or per run (comparison modes)
+typedef struct timeline_config
 {
-  float avgTurnaroundTime;
-  float avgWaitingTime;
-  float avgResponseTime;
-  float throughput;
+  const char *path; // NULL = off
+  int binary;       // varint records instead of one text line per segment
+} timeline_config;
 
-  int totalProcesses;
-} stats;
+static timeline_config timelineConfig = {NULL, 0};
+static const char *segmentReasons[6] = {"end", "complete", "io", "preempt", "slice", "lock"};
 
-// Per-priority statistics structure
-typedef struct priority_stats
+static int schedulerPolicy = HPF_POLICY_PREEMPTIVE;
+
+// CFS weight per priority 1 - 4 (Linux's nice -10, -5, 0, 5): each level gets ~3x the
+// CPU share of the one below it
+static const int cfsWeights[4] = {9548, 3121, 1024, 335};
+
+// Copy the process-wide knobs (hpf_sim.h) and clamp the copy to what the simulator can
+// handle. Nodes run on the copy, so the globals are only ever read, never written.
+static void loadConfig(sim_config *config)
+{
+  config->workload = hpf_workload;
+  config->io = hpf_io;
+  config->locks = hpf_locks;
+  config->cfs = hpf_cfs;
+  config->admission = hpf_admission;
+
+  if (config->workload.maxChildren < 1)
+    config->workload.maxChildren = 1;
+  if (config->io.maxCpuBursts < 1)
+    config->io.maxCpuBursts = 1;
+  if (config->io.maxCpuBursts > (MAX_BURSTS + 1) / 2)
+    config->io.maxCpuBursts = (MAX_BURSTS + 1) / 2;
+  if (config->io.numDevices < 1)
+    config->io.numDevices = 1;
+  if (config->io.numDevices > MAX_DEVICES)
+    config->io.numDevices = MAX_DEVICES;
+  if (config->locks.numLocks < 0)
+    config->locks.numLocks = 0;
+  if (config->locks.numLocks > MAX_LOCKS)
+    config->locks.numLocks = MAX_LOCKS;
+  if (config->cfs.minGranularity < 1)
+    config->cfs.minGranularity = 1; // the simulation can't slice finer than a quantum
+}
+
+// Random helpers, per node so partitions don't share generator state
+static float randomFloat(sim_node *node)
 {
-  stats priorityStats[4]; // Statistics for each priority level (1-4)
-  stats overallStats;     // Overall statistics across all priorities
-} priority_stats;
+  return (float)rand_r(&node->rngState) / (float)(RAND_MAX);
+}
 
-process processList[NUM_PROCESSES];
-int numProcesses = 0;
+static int randomInt(sim_node *node, int n)
+{
+  return rand_r(&node->rngState) % n;
+}
 
 // Priority Queue util functions
-void initQueue(pqueue *q)
+static void initQueue(pqueue *q, int capacity)
 {
+  q->processes = malloc(sizeof(process *) * capacity);
+  q->capacity = capacity;
   // Setting front and rear queue pointers.
   q->front = 0;
   q->rear = -1;
   q->count = 0;
+  q->work = 0;
 }
 
-void enqueue(pqueue *q, process *p)
+static void freeQueue(pqueue *q)
 {
-  if (q->count < NUM_PROCESSES)
+  free(q->processes);
+  q->processes = NULL;
+}
+
+static void enqueue(pqueue *q, process *p)
+{
+  if (q->count < q->capacity)
   {
-    q->rear = (q->rear + 1) % NUM_PROCESSES;
+    q->rear = (q->rear + 1) % q->capacity;
     q->processes[q->rear] = p;
     q->count++;
+    q->work += p->remainingTime;
   }
 }
 
-process *dequeue(pqueue *q)
+static process *dequeue(pqueue *q)
 {
   if (q->count > 0)
   {
     process *p = q->processes[q->front];
-    q->front = (q->front + 1) % NUM_PROCESSES;
+    q->front = (q->front + 1) % q->capacity;
     q->count--;
+    q->work = q->count > 0 ? q->work - p->remainingTime : 0;
     return p;
   }
   return NULL;
 }
 
-void generate_proc()
+// Take p out of the middle of the queue, keeping everyone else's order. 0 if it isn't there.
+static int removeFromQueue(pqueue *q, process *p)
 {
-  numProcesses = 0;
-
-  // "It's ok to create more processes than you use"
-  for (int i = 0; i < NUM_PROCESSES; i++)
+  for (int i = 0; i < q->count; i++)
   {
-    process *simProcess = &processList[numProcesses];
-    simProcess->processName = 'A' + (rand() % 26);
-    // arrival: 0 - 100f, expectedRunTime 0.1 - 10f
-    simProcess->arrivalTime = ((float)rand() / (float)(RAND_MAX)) * 99.0f;
-    simProcess->expectedRunTime = 0.1f + ((float)rand() / (float)(RAND_MAX)) * 9.9f;
-    simProcess->remainingTime = simProcess->expectedRunTime;
-    simProcess->priority = (rand() % 4) + 1; // 1-4, where 1 is highest
-
-    // Statistics
-    simProcess->startTime = -1;
-    simProcess->finishTime = -1;
-    simProcess->turnaroundTime = 0;
-    simProcess->waitingTime = 0;
-    simProcess->timesPreempted = 0;
+    if (q->processes[(q->front + i) % q->capacity] != p)
+      continue;
 
-    numProcesses++;
-  }
-
-  // Sort processes by arrival time
-  for (int i = 0; i < numProcesses - 1; i++)
-  {
-    for (int j = 0; j < numProcesses - i - 1; j++)
+    for (int j = i; j < q->count - 1; j++)
     {
-      if (processList[j].arrivalTime > processList[j + 1].arrivalTime)
-      {
-        process temp = processList[j];
-        processList[j] = processList[j + 1];
-        processList[j + 1] = temp;
-      }
+      q->processes[(q->front + j) % q->capacity] = q->processes[(q->front + j + 1) % q->capacity];
     }
+    q->rear = (q->rear - 1 + q->capacity) % q->capacity;
+    q->count--;
+    q->work = q->count > 0 ? q->work - p->remainingTime : 0;
+    return 1;
   }
-
-  printf("Generated %d processes\n", numProcesses);
+  return 0;
 }
 
-// Process stats
-void calculateStats(stats *s)
+// Timing wheel util functions
+static void slotAppend(timer_slot *slot, process *p)
 {
-  float totalTurnaround = 0;
-  float totalWaiting = 0;
-  float totalResponse = 0;
-  int completedProcesses = 0;
-  float maxFinishTime = 0;
-
-  for (int i = 0; i < numProcesses; i++)
-  {
-    if (processList[i].finishTime >= 0)
-    {
-      totalTurnaround += processList[i].turnaroundTime;
-      totalWaiting += processList[i].waitingTime;
-
-      // Response time = start time - arrival time
-      float responseTime = processList[i].startTime - processList[i].arrivalTime;
-      totalResponse += responseTime;
-
-      completedProcesses++;
+  p->nextTimer = NULL;
+  if (slot->tail != NULL)
+    slot->tail->nextTimer = p;
+  else
+    slot->head = p;
+  slot->tail = p;
+}
 
-      // Track maximum finish time for throughput calculation
-      if (processList[i].finishTime > maxFinishTime)
-      {
-        maxFinishTime = processList[i].finishTime;
-      }
-    }
-  }
+static void initWheel(timing_wheel *w)
+{
+  memset(w, 0, sizeof(*w));
+}
 
-  s->totalProcesses = completedProcesses;
+// O(1): pick the slot from the distance to the due tick
+static void wheelPlace(timing_wheel *w, process *p, int tick)
+{
+  if (tick < w->now)
+    tick = w->now;
+
+  if (tick - w->now < WHEEL_SIZE)
+    slotAppend(&w->level0[tick & WHEEL_MASK], p);
+  else if ((tick >> WHEEL_BITS) - (w->now >> WHEEL_BITS) < WHEEL_SIZE)
+    slotAppend(&w->level1[(tick >> WHEEL_BITS) & WHEEL_MASK], p);
+  else
+    slotAppend(&w->overflow, p);
+}
 
-  s->avgTurnaroundTime = completedProcesses > 0 ? totalTurnaround / completedProcesses : 0;
-  s->avgWaitingTime = completedProcesses > 0 ? totalWaiting / completedProcesses : 0;
+static void wheelInsertAt(timing_wheel *w, process *p, int tick)
+{
+  p->wheelTick = tick;
+  wheelPlace(w, p, tick);
+  w->pending++;
+}
 
-  // the time-interval between submission of a request, and the first response to that request
-  s->avgResponseTime = completedProcesses > 0 ? totalResponse / completedProcesses : 0;
+// A process arriving at time t is picked up on the first tick >= t
+static void wheelInsert(timing_wheel *w, process *p)
+{
+  int tick = (int)p->arrivalTime;
+  if (tick < p->arrivalTime)
+    tick++;
 
-  // Throughput = finished processes / total simulation time
-  s->throughput = maxFinishTime > 0 ? completedProcesses / maxFinishTime : 0;
+  wheelInsertAt(w, p, tick);
 }
 
-// Stats per priority queue
-void calculatePriorityStats(priority_stats *ps)
+// Move a whole slot list back through wheelPlace (cascading / overflow re-check)
+static void wheelRehash(timing_wheel *w, timer_slot *slot)
 {
-  // Initialize stats of each priority queue
-  for (int priority = 0; priority < 4; priority++)
+  process *p = slot->head;
+  slot->head = slot->tail = NULL;
+  while (p != NULL)
   {
-    ps->priorityStats[priority].avgTurnaroundTime = 0;
-    ps->priorityStats[priority].avgWaitingTime = 0;
-    ps->priorityStats[priority].avgResponseTime = 0;
-    ps->priorityStats[priority].throughput = 0;
-    ps->priorityStats[priority].totalProcesses = 0;
+    process *next = p->nextTimer;
+    wheelPlace(w, p, p->wheelTick);
+    p = next;
   }
+}
 
-  float totalTurnaround[4] = {0};
-  float totalWaiting[4] = {0};
-  float totalResponse[4] = {0};
-  int completedProcesses[4] = {0};
-  float maxFinishTime[4] = {0};
-
-  float overallTotalTurnaround = 0;
-  float overallTotalWaiting = 0;
-  float overallTotalResponse = 0;
-  int overallCompletedProcesses = 0;
-  float overallMaxFinishTime = 0;
-
-  // Calculate statistics for each priority and overall
-  for (int i = 0; i < numProcesses; i++)
+// Expire every arrival due at or before `tick`, in slot (FIFO) order
+static void wheelAdvance(timing_wheel *w, int tick, void (*onExpire)(process *, void *), void *ctx)
+{
+  while (w->now <= tick)
   {
-    // Only count processes that actually started (startTime >= 0) and completed
-    if (processList[i].startTime >= 0 && processList[i].finishTime >= 0)
+    // Start of a new 64-quanta block: pull it down from level 1
+    if ((w->now & WHEEL_MASK) == 0)
     {
-      int priority = processList[i].priority - 1; // Convert to 0-based index
-
-      // Per-priority statistics
-      totalTurnaround[priority] += processList[i].turnaroundTime;
-      totalWaiting[priority] += processList[i].waitingTime;
-
-      // resp time - time from arrival to start
-      float responseTime = processList[i].startTime - processList[i].arrivalTime;
-      totalResponse[priority] += responseTime;
-
-      completedProcesses[priority]++;
-
-      if (processList[i].finishTime > maxFinishTime[priority])
-      {
-        maxFinishTime[priority] = processList[i].finishTime;
-      }
-
-      // Overall statistics
-      overallTotalTurnaround += processList[i].turnaroundTime;
-      overallTotalWaiting += processList[i].waitingTime;
-      overallTotalResponse += responseTime;
-      overallCompletedProcesses++;
-
-      if (processList[i].finishTime > overallMaxFinishTime)
-      {
-        overallMaxFinishTime = processList[i].finishTime;
-      }
+      if (((w->now >> WHEEL_BITS) & WHEEL_MASK) == 0)
+        wheelRehash(w, &w->overflow);
+      wheelRehash(w, &w->level1[(w->now >> WHEEL_BITS) & WHEEL_MASK]);
     }
-  }
 
-  // Calculate averages for each priority queue
-  for (int priority = 0; priority < 4; priority++)
-  {
-    ps->priorityStats[priority].totalProcesses = completedProcesses[priority];
-
-    if (completedProcesses[priority] > 0)
+    timer_slot *slot = &w->level0[w->now & WHEEL_MASK];
+    process *p = slot->head;
+    slot->head = slot->tail = NULL;
+    while (p != NULL)
     {
-      ps->priorityStats[priority].avgTurnaroundTime = totalTurnaround[priority] / completedProcesses[priority];
-      ps->priorityStats[priority].avgWaitingTime = totalWaiting[priority] / completedProcesses[priority];
-      ps->priorityStats[priority].avgResponseTime = totalResponse[priority] / completedProcesses[priority];
+      process *next = p->nextTimer;
+      p->nextTimer = NULL;
+      w->pending--;
+      onExpire(p, ctx);
+      p = next;
     }
 
-    if (maxFinishTime[priority] > 0)
-    {
-      ps->priorityStats[priority].throughput = completedProcesses[priority] / maxFinishTime[priority];
-    }
+    w->now++;
   }
+}
 
-  // Calculate overall averages
-  ps->overallStats.totalProcesses = overallCompletedProcesses;
-
-  if (overallCompletedProcesses > 0)
+// Blocked heap util functions
+static void blockedPush(blocked_heap *h, process *p)
+{
+  int i = h->count++;
+  while (i > 0)
   {
-    ps->overallStats.avgTurnaroundTime = overallTotalTurnaround / overallCompletedProcesses;
-    ps->overallStats.avgWaitingTime = overallTotalWaiting / overallCompletedProcesses;
-    ps->overallStats.avgResponseTime = overallTotalResponse / overallCompletedProcesses;
+    int parent = (i - 1) / 2;
+    if (h->processes[parent]->wakeupTime <= p->wakeupTime)
+      break;
+    h->processes[i] = h->processes[parent];
+    i = parent;
   }
+  h->processes[i] = p;
+}
 
-  if (overallMaxFinishTime > 0)
+static process *blockedPop(blocked_heap *h)
+{
+  process *top = h->processes[0];
+  process *last = h->processes[--h->count];
+  int i = 0;
+  while (1)
   {
-    ps->overallStats.throughput = overallCompletedProcesses / overallMaxFinishTime;
+    int child = 2 * i + 1;
+    if (child >= h->count)
+      break;
+    if (child + 1 < h->count && h->processes[child + 1]->wakeupTime < h->processes[child]->wakeupTime)
+      child++;
+    if (last->wakeupTime <= h->processes[child]->wakeupTime)
+      break;
+    h->processes[i] = h->processes[child];
+    i = child;
   }
+  if (h->count > 0)
+    h->processes[i] = last;
+  return top;
 }
 
-void printPriorityStats(priority_stats *ps, const char *algorithmName)
+// CFS red-black tree util functions
+static int cfsLess(process *a, process *b)
 {
-  printf("\n=== %s PQueue Statistics ===\n", algorithmName);
+  if (a->vruntime != b->vruntime)
+    return a->vruntime < b->vruntime;
+  return a->processId < b->processId;
+}
 
-  // Print statistics for each priority queue
-  for (int priority = 0; priority < 4; priority++)
-  {
-    printf("\n--- Priority %d Statistics ---\n", priority + 1);
-    printf("Total Processes Completed: %d\n", ps->priorityStats[priority].totalProcesses);
+static void rbRotateLeft(cfs_tree *t, process *x)
+{
+  process *y = x->rbRight;
+  x->rbRight = y->rbLeft;
+  if (y->rbLeft != NULL)
+    y->rbLeft->rbParent = x;
+  y->rbParent = x->rbParent;
+  if (x->rbParent == NULL)
+    t->root = y;
+  else if (x == x->rbParent->rbLeft)
+    x->rbParent->rbLeft = y;
+  else
+    x->rbParent->rbRight = y;
+  y->rbLeft = x;
+  x->rbParent = y;
+}
 
-    if (ps->priorityStats[priority].totalProcesses > 0)
+static void rbRotateRight(cfs_tree *t, process *x)
+{
+  process *y = x->rbLeft;
+  x->rbLeft = y->rbRight;
+  if (y->rbRight != NULL)
+    y->rbRight->rbParent = x;
+  y->rbParent = x->rbParent;
+  if (x->rbParent == NULL)
+    t->root = y;
+  else if (x == x->rbParent->rbRight)
+    x->rbParent->rbRight = y;
+  else
+    x->rbParent->rbLeft = y;
+  y->rbRight = x;
+  x->rbParent = y;
+}
+
+// O(log n)
+static void cfsInsert(cfs_tree *t, process *p)
+{
+  process *parent = NULL;
+  process **link = &t->root;
+  int leftmost = 1;
+
+  while (*link != NULL)
+  {
+    parent = *link;
+    if (cfsLess(p, parent))
     {
-      printf("Avg. Turnaround Time: %.2f quanta\n", ps->priorityStats[priority].avgTurnaroundTime);
-      printf("Avg. Waiting Time: %.2f quanta\n", ps->priorityStats[priority].avgWaitingTime);
-      printf("Avg. Response Time: %.2f quanta\n", ps->priorityStats[priority].avgResponseTime);
-      printf("Throughput: %.2f processes/quantum\n", ps->priorityStats[priority].throughput);
+      link = &parent->rbLeft;
     }
     else
     {
-      printf("N/A (starvation)\n");
-      printf("Avg Turnaround Time: N/A\n");
-      printf("Avg Waiting Time: N/A\n");
-      printf("Avg Response Time: N/A\n");
-      printf("Throughput: N/A\n");
+      link = &parent->rbRight;
+      leftmost = 0;
     }
   }
 
-  // Print overall statistics
-  printf("\n--- Overall Statistics ---\n");
-  printf("Total Processes Completed: %d\n", ps->overallStats.totalProcesses);
-  printf("Avg Turnaround Time: %.2f quanta\n", ps->overallStats.avgTurnaroundTime);
-  printf("Avg Waiting Time: %.2f quanta\n", ps->overallStats.avgWaitingTime);
-  printf("Avg Response Time: %.2f quanta\n", ps->overallStats.avgResponseTime);
-  printf("Throughput: %.2f processes/quantum\n", ps->overallStats.throughput);
+  p->rbParent = parent;
+  p->rbLeft = p->rbRight = NULL;
+  p->rbRed = 1;
+  *link = p;
+  if (leftmost)
+    t->leftmost = p;
+
+  // Fix up red-red violations on the way back to the root
+  while ((parent = p->rbParent) != NULL && parent->rbRed)
+  {
+    process *grand = parent->rbParent;
+    if (parent == grand->rbLeft)
+    {
+      process *uncle = grand->rbRight;
+      if (uncle != NULL && uncle->rbRed)
+      {
+        parent->rbRed = uncle->rbRed = 0;
+        grand->rbRed = 1;
+        p = grand;
+        continue;
+      }
+      if (p == parent->rbRight)
+      {
+        rbRotateLeft(t, parent);
+        p = parent;
+        parent = p->rbParent;
+      }
+      parent->rbRed = 0;
+      grand->rbRed = 1;
+      rbRotateRight(t, grand);
+    }
+    else
+    {
+      process *uncle = grand->rbLeft;
+      if (uncle != NULL && uncle->rbRed)
+      {
+        parent->rbRed = uncle->rbRed = 0;
+        grand->rbRed = 1;
+        p = grand;
+        continue;
+      }
+      if (p == parent->rbLeft)
+      {
+        rbRotateRight(t, parent);
+        p = parent;
+        parent = p->rbParent;
+      }
+      parent->rbRed = 0;
+      grand->rbRed = 1;
+      rbRotateLeft(t, grand);
+    }
+  }
+  t->root->rbRed = 0;
+  t->count++;
 }
 
-// HPF Preemptive Scheduling
-void hpf_preemptive()
+static process *rbNext(process *p)
 {
-  pqueue priorityQueues[4];
-  for (int i = 0; i < 4; i++)
+  if (p->rbRight != NULL)
   {
-    initQueue(&priorityQueues[i]);
+    p = p->rbRight;
+    while (p->rbLeft != NULL)
+      p = p->rbLeft;
+    return p;
   }
+  while (p->rbParent != NULL && p == p->rbParent->rbRight)
+    p = p->rbParent;
+  return p->rbParent;
+}
 
-  int currentTime = 0;
-  int processIndex = 0;
-  process *currentProcess = NULL;
-  priority_stats schedulerStats = {0};
-  int idleTime = 0;
-  int totalPreemptions = 0;
+static void rbTransplant(cfs_tree *t, process *u, process *v)
+{
+  if (u->rbParent == NULL)
+    t->root = v;
+  else if (u == u->rbParent->rbLeft)
+    u->rbParent->rbLeft = v;
+  else
+    u->rbParent->rbRight = v;
+  if (v != NULL)
+    v->rbParent = u->rbParent;
+}
+
+// O(log n)
+static void cfsErase(cfs_tree *t, process *z)
+{
+  if (t->leftmost == z)
+    t->leftmost = rbNext(z);
 
-  printf("\nHPF Preemptive Scheduling \n");
-  printf("Time\tPID\tPriority Lvl\tRemaining\tStatus\n");
+  process *y = z;
+  process *x;
+  process *xParent;
+  int removedRed = y->rbRed;
 
-  while (currentTime < MAX_QUANTA * 2)
+  if (z->rbLeft == NULL)
   {
-    // Allow completion beyond 100 quanta
-    while (processIndex < numProcesses &&
-           processList[processIndex].arrivalTime <= currentTime &&
-           processList[processIndex].arrivalTime < MAX_QUANTA)
+    x = z->rbRight;
+    xParent = z->rbParent;
+    rbTransplant(t, z, z->rbRight);
+  }
+  else if (z->rbRight == NULL)
+  {
+    x = z->rbLeft;
+    xParent = z->rbParent;
+    rbTransplant(t, z, z->rbLeft);
+  }
+  else
+  {
+    // Two children: the successor takes z's place
+    y = z->rbRight;
+    while (y->rbLeft != NULL)
+      y = y->rbLeft;
+    removedRed = y->rbRed;
+    x = y->rbRight;
+    if (y->rbParent == z)
     {
-
-      int priority = processList[processIndex].priority - 1; // Convert to 0-based index
-      // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
-      enqueue(&priorityQueues[priority], &processList[processIndex]);
-      printf("%d\t%c\t%d\t\t%.1f\t\tArrived\n",
-             currentTime, processList[processIndex].processName,
-             processList[processIndex].priority, processList[processIndex].remainingTime);
-      processIndex++;
+      xParent = y;
     }
-
-    // Check if current process should be preempted
-    if (currentProcess != NULL)
+    else
     {
-      // Check if a higher priority process has arrived
-      for (int i = 0; i < currentProcess->priority - 1; i++)
-      {
-        if (priorityQueues[i].count > 0)
-        {
-          // Preempt current process
-          // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
-          printf("%d\t%c\t%d\t\t%.1f\t\tPreempt\n",
-                 currentTime, currentProcess->processName,
-                 currentProcess->priority, currentProcess->remainingTime);
-
-          int currentPriority = currentProcess->priority - 1;
-          enqueue(&priorityQueues[currentPriority], currentProcess);
-          currentProcess->timesPreempted++;
-          totalPreemptions++;
-          currentProcess = NULL;
-          break;
-        }
-      }
+      xParent = y->rbParent;
+      rbTransplant(t, y, y->rbRight);
+      y->rbRight = z->rbRight;
+      y->rbRight->rbParent = y;
     }
+    rbTransplant(t, z, y);
+    y->rbLeft = z->rbLeft;
+    y->rbLeft->rbParent = y;
+    y->rbRed = z->rbRed;
+  }
+  t->count--;
+
+  if (removedRed)
+    return;
 
-    // Select next process if no current process
-    if (currentProcess == NULL)
+  // A black node went missing on x's path: rebalance
+  while (x != t->root && (x == NULL || !x->rbRed))
+  {
+    if (x == xParent->rbLeft)
     {
-      for (int i = 0; i < 4; i++)
+      process *w = xParent->rbRight;
+      if (w->rbRed)
       {
-        if (priorityQueues[i].count > 0)
+        w->rbRed = 0;
+        xParent->rbRed = 1;
+        rbRotateLeft(t, xParent);
+        w = xParent->rbRight;
+      }
+      if ((w->rbLeft == NULL || !w->rbLeft->rbRed) && (w->rbRight == NULL || !w->rbRight->rbRed))
+      {
+        w->rbRed = 1;
+        x = xParent;
+        xParent = x->rbParent;
+      }
+      else
+      {
+        if (w->rbRight == NULL || !w->rbRight->rbRed)
         {
-          // Check if it's the first time a process ran after quanta > 99
-          // DO NOT dequeue yet
-          process *tempProc = priorityQueues[i].processes[priorityQueues[i].front];
-
-          if (tempProc->startTime < 0 && currentTime > MAX_QUANTA)
-          {
-            continue;
-          }
-
-          currentProcess = dequeue(&priorityQueues[i]);
-
-          if (currentProcess->startTime < 0)
-          {
-            currentProcess->startTime = currentTime;
-          }
-          // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
-          printf("%d\t%c\t%d\t\t%.1f\t\tStart\n",
-                 currentTime, currentProcess->processName,
-                 currentProcess->priority, currentProcess->remainingTime);
-          break;
+          w->rbLeft->rbRed = 0;
+          w->rbRed = 1;
+          rbRotateRight(t, w);
+          w = xParent->rbRight;
         }
+        w->rbRed = xParent->rbRed;
+        xParent->rbRed = 0;
+        if (w->rbRight != NULL)
+          w->rbRight->rbRed = 0;
+        rbRotateLeft(t, xParent);
+        x = t->root;
       }
     }
-
-    if (currentProcess != NULL)
+    else
     {
-      // run process for 1 quantum
-      currentProcess->remainingTime -= 1.0f;
-
-      if (currentProcess->remainingTime <= 0)
+      process *w = xParent->rbLeft;
+      if (w->rbRed)
       {
-        // Process completed
-        currentProcess->finishTime = currentTime++;
-        // turnaroundtime = finish - arrival
-        currentProcess->turnaroundTime = currentProcess->finishTime - currentProcess->arrivalTime;
-        // wait = turnaround - expectedruntime
-        currentProcess->waitingTime = currentProcess->turnaroundTime - currentProcess->expectedRunTime;
-
-        // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
-        printf("%d\t%c\t%d\t\t%.1f\t\tComplete\n",
-               currentTime++, currentProcess->processName,
-               currentProcess->priority, currentProcess->remainingTime);
-
-        currentProcess = NULL;
-        idleTime = 0;
+        w->rbRed = 0;
+        xParent->rbRed = 1;
+        rbRotateRight(t, xParent);
+        w = xParent->rbLeft;
+      }
+      if ((w->rbLeft == NULL || !w->rbLeft->rbRed) && (w->rbRight == NULL || !w->rbRight->rbRed))
+      {
+        w->rbRed = 1;
+        x = xParent;
+        xParent = x->rbParent;
       }
       else
       {
-        // current process --> back to rear of its priority queue (RR)
-        int currentPriority = currentProcess->priority - 1;
-        enqueue(&priorityQueues[currentPriority], currentProcess);
-        currentProcess = NULL; 
+        if (w->rbLeft == NULL || !w->rbLeft->rbRed)
+        {
+          w->rbRight->rbRed = 0;
+          w->rbRed = 1;
+          rbRotateLeft(t, w);
+          w = xParent->rbLeft;
+        }
+        w->rbRed = xParent->rbRed;
+        xParent->rbRed = 0;
+        if (w->rbLeft != NULL)
+          w->rbLeft->rbRed = 0;
+        rbRotateRight(t, xParent);
+        x = t->root;
       }
     }
-    else
-    {
-      // CPU is idle
-      idleTime++;
-      if (idleTime <= 2)
-        printf("%d\t-\t-\t\t-\t\tIdle\n", currentTime);
+  }
+  if (x != NULL)
+    x->rbRed = 0;
+}
+
+// Node util functions
+static void initNode(sim_node *node, int nodeId, int maxProcesses, unsigned int seed)
+{
+  memset(node, 0, sizeof(*node));
+  node->nodeId = nodeId;
+  loadConfig(&node->config);
+  node->maxProcesses = maxProcesses;
+  node->processList = malloc(sizeof(process) * maxProcesses);
+  for (int i = 0; i < 4; i++)
+  {
+    initQueue(&node->priorityQueues[i], maxProcesses);
+  }
+  initWheel(&node->arrivalWheel);
+  node->blocked.processes = malloc(sizeof(process *) * maxProcesses);
+  for (int l = 0; l < node->config.locks.numLocks; l++)
+  {
+    node->locks[l].waiters = malloc(sizeof(process *) * maxProcesses);
+    node->locks[l].ceiling = 4;
+  }
+  node->lockProtocol = node->config.locks.protocol;
+  node->policy = schedulerPolicy;
+  node->admissionPolicies = node->config.admission.policies;
+  for (int i = 0; i < 4; i++)
+  {
+    node->tokens[i] = node->config.admission.bucketSize[i];
+  }
+  node->rngState = seed;
+}
+
+static void freeNode(sim_node *node)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    freeQueue(&node->priorityQueues[i]);
+  }
+  free(node->blocked.processes);
+  for (int l = 0; l < node->config.locks.numLocks; l++)
+  {
+    free(node->locks[l].waiters);
+  }
+  free(node->processList);
+  node->processList = NULL;
+  if (node->timeline != NULL)
+    free(node->timeline->data);
+  free(node->timeline);
+  node->timeline = NULL;
+}
+
+// Back to an empty node with a new seed, keeping the allocations for the next run
+static void resetNode(sim_node *node, unsigned int seed)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    node->priorityQueues[i].front = 0;
+    node->priorityQueues[i].rear = -1;
+    node->priorityQueues[i].count = 0;
+    node->priorityQueues[i].work = 0;
+  }
+  initWheel(&node->arrivalWheel);
+  node->blocked.count = 0;
+  memset(&node->cfs, 0, sizeof(node->cfs));
+  node->minVruntime = 0;
+  node->sliceLeft = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    node->tokens[i] = node->config.admission.bucketSize[i];
+    node->tokensAt[i] = 0;
+  }
+  memset(node->devices, 0, sizeof(node->devices));
+  for (int l = 0; l < node->config.locks.numLocks; l++)
+  {
+    node->locks[l].holder = NULL;
+    node->locks[l].numWaiters = 0;
+    node->locks[l].ceiling = 4;
+  }
+
+  node->numProcesses = 0;
+  node->currentProcess = NULL;
+  node->currentTime = 0;
+  node->idleTime = 0;
+  node->totalPreemptions = 0;
+  node->cpuBusyTime = 0;
+  node->deviceBusyTime = 0;
+  node->overlapTime = 0;
+  node->resubmittedProcesses = 0;
+  node->spawnedProcesses = 0;
+  node->droppedProcesses = 0;
+  node->cutOffProcesses = 0;
+  node->migratedOut = 0;
+  node->migratedIn = 0;
+  node->migrationSeq = 0;
+  if (node->timeline != NULL)
+  {
+    unsigned char *data = node->timeline->data;
+    size_t capacity = node->timeline->capacity;
+    memset(node->timeline, 0, sizeof(*node->timeline));
+    node->timeline->data = data;
+    node->timeline->capacity = capacity;
+  }
+  node->rngState = seed;
+}
+
+// Take a fresh slot in the process table, NULL when it is full
+static process *allocProcess(sim_node *node)
+{
+  if (node->numProcesses >= node->maxProcesses)
+  {
+    node->droppedProcesses++;
+    return NULL;
+  }
+
+  process *simProcess = &node->processList[node->numProcesses];
+  memset(simProcess, 0, sizeof(*simProcess));
+  simProcess->processId = node->numProcesses;
+  simProcess->parentId = -1;
+  simProcess->startTime = -1;
+  simProcess->finishTime = -1;
+
+  node->numProcesses++;
+  return simProcess;
+}
+
+// Split the expected run time into CPU bursts with I/O requests in between. Without
+// I/O mode a process is a single CPU burst. The CPU runs whole quanta, so the split is in
+// whole quanta too (the run time rounded up, like a single burst uses), and there are
+// never more CPU bursts than quanta.
+static void initBursts(sim_node *node, process *p)
+{
+  int cpuBursts = node->config.io.enabled ? 1 + randomInt(node, node->config.io.maxCpuBursts) : 1;
+  int quanta = (int)ceilf(p->expectedRunTime);
+  if (quanta < 1)
+    quanta = 1;
+  if (cpuBursts > quanta)
+    cpuBursts = quanta;
+
+  p->numBursts = 2 * cpuBursts - 1;
+  for (int i = 0; i < p->numBursts; i++)
+  {
+    if (i % 2 == 0)
+      p->bursts[i] = quanta / cpuBursts + (i / 2 < quanta % cpuBursts ? 1 : 0);
+    else
+      p->bursts[i] = node->config.io.minServiceTime +
+                     randomFloat(node) * (node->config.io.maxServiceTime - node->config.io.minServiceTime);
+  }
+  p->burstIndex = 0;
+  p->burstRemaining = p->bursts[0];
+  p->ioWaitTime = 0;
+}
+
+// Decide whether (and when) the process uses a shared lock. Call once priority is set.
+static void initLockUse(sim_node *node, process *p)
+{
+  p->effectivePriority = p->priority;
+  p->lockId = -1;
+  p->lockState = LOCK_NOT_TAKEN;
+  p->lockBlockedTime = 0;
+  p->inversionTime = 0;
+
+  if (node->config.locks.numLocks == 0 || randomFloat(node) >= node->config.locks.useProbability)
+    return;
+
+  p->lockId = randomInt(node, node->config.locks.numLocks);
+  p->lockAcquireAt = node->config.locks.acquireAt * p->expectedRunTime;
+  p->lockReleaseAt = p->lockAcquireAt + node->config.locks.holdTime;
+  if (p->lockReleaseAt > p->expectedRunTime)
+    p->lockReleaseAt = p->expectedRunTime;
+
+  sim_lock *lock = &node->locks[p->lockId];
+  if (p->priority < lock->ceiling)
+    lock->ceiling = p->priority;
+}
+
+static int compareArrival(const void *a, const void *b)
+{
+  const process *pa = a;
+  const process *pb = b;
+  if (pa->arrivalTime != pb->arrivalTime)
+    return pa->arrivalTime < pb->arrivalTime ? -1 : 1;
+  // Keep generation order for ties, like the old bubble sort did
+  return pa->processId - pb->processId;
+}
+
+static void generate_proc(sim_node *node, int count)
+{
+  node->numProcesses = 0;
+
+  // "It's ok to create more processes than you use"
+  for (int i = 0; i < count; i++)
+  {
+    process *simProcess = allocProcess(node);
+    if (simProcess == NULL)
+      break;
+    simProcess->processName = 'A' + randomInt(node, 26);
+    // arrival: 0 - 100f, expectedRunTime 0.1 - 10f
+    simProcess->arrivalTime = randomFloat(node) * 99.0f;
+    simProcess->expectedRunTime = 0.1f + randomFloat(node) * 9.9f;
+    simProcess->remainingTime = simProcess->expectedRunTime;
+    simProcess->priority = randomInt(node, 4) + 1; // 1-4, where 1 is highest
+    initBursts(node, simProcess);
+    initLockUse(node, simProcess);
+
+    // Statistics
+    simProcess->turnaroundTime = 0;
+    simProcess->waitingTime = 0;
+    simProcess->timesPreempted = 0;
+    simProcess->resubmitsLeft = node->config.workload.closedLoop ? node->config.workload.maxResubmits : 0;
+  }
+
+  // Sort processes by arrival time
+  qsort(node->processList, node->numProcesses, sizeof(process), compareArrival);
+
+  // Ids follow arrival order
+  for (int i = 0; i < node->numProcesses; i++)
+  {
+    node->processList[i].processId = i;
+  }
+
+  LOG(node, "Generated %d processes\n", node->numProcesses);
+}
+
+// One given process (library, traces). NULL if the table is full or the priority isn't 1 - 4.
+static process *addProcess(sim_node *node, float arrivalTime, float runTime, int priority)
+{
+  if (priority < 1 || priority > 4)
+    return NULL;
+
+  process *simProcess = allocProcess(node);
+  if (simProcess == NULL)
+    return NULL;
+
+  simProcess->processName = 'A' + simProcess->processId % 26;
+  simProcess->arrivalTime = arrivalTime;
+  simProcess->expectedRunTime = runTime;
+  simProcess->remainingTime = runTime;
+  simProcess->priority = priority;
+  simProcess->resubmitsLeft = node->config.workload.closedLoop ? node->config.workload.maxResubmits : 0;
+  initBursts(node, simProcess);
+  initLockUse(node, simProcess);
+  return simProcess;
+}
+
+static float randomThinkTime(sim_node *node)
+{
+  workload_config *workload = &node->config.workload;
+  return workload->minThinkTime + randomFloat(node) * (workload->maxThinkTime - workload->minThinkTime);
+}
+
+static void pushMigration(migration_list *list, migration *m)
+{
+  if (list->count == list->capacity)
+  {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->items = realloc(list->items, sizeof(migration) * list->capacity);
+  }
+  list->items[list->count++] = *m;
+}
+
+// Start a follow-up of `parent` arriving at `arrivalTime`, locally or on another node.
+// Returns 0 when the follow-up can't be simulated.
+static int routeFollowUp(sim_node *node, process *parent, float arrivalTime, int resubmitsLeft)
+{
+  float expectedRunTime = 0.1f + randomFloat(node) * 9.9f;
+
+  if (node->outbox != NULL && clusterConfig.numNodes > 1 &&
+      randomFloat(node) < clusterConfig.migrateProbability)
+  {
+    migration m;
+    m.dstNode = (node->nodeId + 1 + randomInt(node, clusterConfig.numNodes - 1)) % clusterConfig.numNodes;
+    m.srcNode = node->nodeId;
+    m.seq = node->migrationSeq++;
+    m.parentId = parent->processId;
+    m.processName = parent->processName;
+    m.priority = parent->priority;
+    m.resubmitsLeft = resubmitsLeft;
+    m.arrivalTime = arrivalTime + clusterConfig.migrationDelay;
+    m.expectedRunTime = expectedRunTime;
+
+    // Same cut-off as the original arrival list: nothing arrives after MAX_QUANTA
+    if (m.arrivalTime >= MAX_QUANTA)
+    {
+      node->cutOffProcesses++;
+      return 0;
+    }
+
+    pushMigration(node->outbox, &m);
+    node->migratedOut++;
+    return 1;
+  }
+
+  if (arrivalTime >= MAX_QUANTA)
+  {
+    node->cutOffProcesses++;
+    return 0;
+  }
+
+  process *simProcess = allocProcess(node);
+  if (simProcess == NULL)
+    return 0;
+
+  simProcess->parentId = parent->processId;
+  simProcess->processName = parent->processName;
+  simProcess->arrivalTime = arrivalTime;
+  simProcess->expectedRunTime = expectedRunTime;
+  simProcess->remainingTime = expectedRunTime;
+  simProcess->priority = parent->priority; // follow-up work keeps its client's priority
+  simProcess->resubmitsLeft = resubmitsLeft;
+  initBursts(node, simProcess);
+  initLockUse(node, simProcess);
+  wheelInsert(&node->arrivalWheel, simProcess);
+  return 1;
+}
+
+// Closed loop: on completion a client may resubmit after thinking, and may spawn children
+static void onProcessComplete(sim_node *node, process *p)
+{
+  if (!node->config.workload.closedLoop)
+    return;
+
+  if (p->resubmitsLeft > 0 &&
+      routeFollowUp(node, p, p->finishTime + randomThinkTime(node), p->resubmitsLeft - 1))
+  {
+    node->resubmittedProcesses++;
+  }
+
+  if (node->config.workload.spawnProbability > 0 && randomFloat(node) < node->config.workload.spawnProbability)
+  {
+    int children = 1 + randomInt(node, node->config.workload.maxChildren);
+    for (int i = 0; i < children; i++)
+    {
+      if (routeFollowUp(node, p, p->finishTime + randomThinkTime(node), 0))
+        node->spawnedProcesses++;
+    }
+  }
+}
+
+// Process stats
+static int compareFloat(const void *a, const void *b)
+{
+  float fa = *(const float *)a;
+  float fb = *(const float *)b;
+  return (fa > fb) - (fa < fb);
+}
+
+// Nearest-rank 99th percentile waiting time of the completed processes of `priority`
+// (0 = all of them). `buffer` needs room for every process of every node.
+static float p99WaitingTime(sim_node *nodes, int numNodes, int priority, float *buffer)
+{
+  int count = 0;
+  for (int n = 0; n < numNodes; n++)
+  {
+    for (int i = 0; i < nodes[n].numProcesses; i++)
+    {
+      process *p = &nodes[n].processList[i];
+      if (p->startTime >= 0 && p->finishTime >= 0 && (priority == 0 || p->priority == priority))
+        buffer[count++] = p->waitingTime;
+    }
+  }
+  if (count == 0)
+    return 0;
+
+  qsort(buffer, count, sizeof(float), compareFloat);
+  int rank = (int)ceil(0.99 * count);
+  return buffer[rank - 1];
+}
+
+// Stats per priority queue, over every node of the run (in node order)
+static void calculatePriorityStats(priority_stats *ps, sim_node *nodes, int numNodes)
+{
+  // Initialize stats of each priority queue
+  for (int priority = 0; priority < 4; priority++)
+  {
+    ps->priorityStats[priority].avgTurnaroundTime = 0;
+    ps->priorityStats[priority].avgWaitingTime = 0;
+    ps->priorityStats[priority].avgResponseTime = 0;
+    ps->priorityStats[priority].avgIoWaitTime = 0;
+    ps->priorityStats[priority].avgLockBlockedTime = 0;
+    ps->priorityStats[priority].avgInversionTime = 0;
+    ps->priorityStats[priority].maxInversionTime = 0;
+    ps->priorityStats[priority].p99WaitingTime = 0;
+    ps->priorityStats[priority].throughput = 0;
+    ps->priorityStats[priority].totalProcesses = 0;
+    ps->priorityStats[priority].rejectedProcesses = 0;
+    ps->priorityStats[priority].deferredProcesses = 0;
+  }
+
+  float totalTurnaround[4] = {0};
+  float totalWaiting[4] = {0};
+  float totalResponse[4] = {0};
+  float totalIoWait[4] = {0};
+  float totalLockBlocked[4] = {0};
+  float totalInversion[4] = {0};
+  float maxInversion[4] = {0};
+  int completedProcesses[4] = {0};
+  float maxFinishTime[4] = {0};
+
+  float overallTotalTurnaround = 0;
+  float overallTotalWaiting = 0;
+  float overallTotalResponse = 0;
+  float overallTotalIoWait = 0;
+  float overallTotalLockBlocked = 0;
+  float overallTotalInversion = 0;
+  float overallMaxInversion = 0;
+  int overallCompletedProcesses = 0;
+  float overallMaxFinishTime = 0;
+  int totalProcesses = 0;
+
+  // Calculate statistics for each priority and overall
+  for (int n = 0; n < numNodes; n++)
+  {
+    process *processList = nodes[n].processList;
+    totalProcesses += nodes[n].numProcesses;
+    for (int i = 0; i < nodes[n].numProcesses; i++)
+    {
+      // Admission control outcomes, whether or not the process got to run
+      if (processList[i].admission == ADMIT_REJECT)
+        ps->priorityStats[processList[i].priority - 1].rejectedProcesses++;
+      if (processList[i].timesDeferred > 0)
+        ps->priorityStats[processList[i].priority - 1].deferredProcesses++;
+
+      // Only count processes that actually started (startTime >= 0) and completed
+      if (processList[i].startTime >= 0 && processList[i].finishTime >= 0)
+      {
+        int priority = processList[i].priority - 1; // Convert to 0-based index
+
+        // Per-priority statistics
+        totalTurnaround[priority] += processList[i].turnaroundTime;
+        totalWaiting[priority] += processList[i].waitingTime;
+
+        // resp time - time from arrival to start
+        float responseTime = processList[i].startTime - processList[i].arrivalTime;
+        totalResponse[priority] += responseTime;
+        totalIoWait[priority] += processList[i].ioWaitTime;
+        totalLockBlocked[priority] += processList[i].lockBlockedTime;
+        totalInversion[priority] += processList[i].inversionTime;
+        if (processList[i].inversionTime > maxInversion[priority])
+          maxInversion[priority] = processList[i].inversionTime;
+
+        completedProcesses[priority]++;
+
+        if (processList[i].finishTime > maxFinishTime[priority])
+        {
+          maxFinishTime[priority] = processList[i].finishTime;
+        }
+
+        // Overall statistics
+        overallTotalTurnaround += processList[i].turnaroundTime;
+        overallTotalWaiting += processList[i].waitingTime;
+        overallTotalResponse += responseTime;
+        overallTotalIoWait += processList[i].ioWaitTime;
+        overallTotalLockBlocked += processList[i].lockBlockedTime;
+        overallTotalInversion += processList[i].inversionTime;
+        if (processList[i].inversionTime > overallMaxInversion)
+          overallMaxInversion = processList[i].inversionTime;
+        overallCompletedProcesses++;
+
+        if (processList[i].finishTime > overallMaxFinishTime)
+        {
+          overallMaxFinishTime = processList[i].finishTime;
+        }
+      }
+    }
+  }
+
+  float *waitingTimes = malloc(sizeof(float) * (totalProcesses > 0 ? totalProcesses : 1));
+
+  // Calculate averages for each priority queue
+  for (int priority = 0; priority < 4; priority++)
+  {
+    ps->priorityStats[priority].totalProcesses = completedProcesses[priority];
+    ps->priorityStats[priority].p99WaitingTime = p99WaitingTime(nodes, numNodes, priority + 1, waitingTimes);
+
+    if (completedProcesses[priority] > 0)
+    {
+      ps->priorityStats[priority].avgTurnaroundTime = totalTurnaround[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].avgWaitingTime = totalWaiting[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].avgResponseTime = totalResponse[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].avgIoWaitTime = totalIoWait[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].avgLockBlockedTime = totalLockBlocked[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].avgInversionTime = totalInversion[priority] / completedProcesses[priority];
+      ps->priorityStats[priority].maxInversionTime = maxInversion[priority];
+    }
+
+    if (maxFinishTime[priority] > 0)
+    {
+      ps->priorityStats[priority].throughput = completedProcesses[priority] / maxFinishTime[priority];
+    }
+  }
+
+  // Calculate overall averages
+  ps->overallStats.totalProcesses = overallCompletedProcesses;
+  ps->overallStats.p99WaitingTime = p99WaitingTime(nodes, numNodes, 0, waitingTimes);
+  ps->overallStats.rejectedProcesses = 0;
+  ps->overallStats.deferredProcesses = 0;
+  for (int priority = 0; priority < 4; priority++)
+  {
+    ps->overallStats.rejectedProcesses += ps->priorityStats[priority].rejectedProcesses;
+    ps->overallStats.deferredProcesses += ps->priorityStats[priority].deferredProcesses;
+  }
+  free(waitingTimes);
+
+  if (overallCompletedProcesses > 0)
+  {
+    ps->overallStats.avgTurnaroundTime = overallTotalTurnaround / overallCompletedProcesses;
+    ps->overallStats.avgWaitingTime = overallTotalWaiting / overallCompletedProcesses;
+    ps->overallStats.avgResponseTime = overallTotalResponse / overallCompletedProcesses;
+    ps->overallStats.avgIoWaitTime = overallTotalIoWait / overallCompletedProcesses;
+    ps->overallStats.avgLockBlockedTime = overallTotalLockBlocked / overallCompletedProcesses;
+    ps->overallStats.avgInversionTime = overallTotalInversion / overallCompletedProcesses;
+    ps->overallStats.maxInversionTime = overallMaxInversion;
+  }
+
+  if (overallMaxFinishTime > 0)
+  {
+    ps->overallStats.throughput = overallCompletedProcesses / overallMaxFinishTime;
+  }
+}
+
+// CFS: queue p in the tree. New and woken processes don't get credit for time they
+// weren't runnable, so they start no earlier than minVruntime.
+static void cfsEnqueue(sim_node *node, process *p)
+{
+  if (p->vruntime < node->minVruntime)
+    p->vruntime = node->minVruntime;
+  p->weight = cfsWeights[p->effectivePriority - 1];
+  cfsInsert(&node->cfs, p);
+  node->cfs.totalWeight += p->weight;
+  node->cfs.queued[p->priority - 1]++;
+  node->cfs.work += p->remainingTime;
+}
+
+static void cfsDequeue(sim_node *node, process *p)
+{
+  cfsErase(&node->cfs, p);
+  node->cfs.totalWeight -= p->weight;
+  node->cfs.queued[p->priority - 1]--;
+  node->cfs.work = node->cfs.count > 0 ? node->cfs.work - p->remainingTime : 0;
+}
+
+// Put p back where the policy picks from. It has been ready since `readyAt`; the time
+// until it is picked counts as waiting.
+static void makeRunnable(sim_node *node, process *p, float readyAt)
+{
+  p->readySince = readyAt;
+  if (node->policy == HPF_POLICY_CFS)
+    cfsEnqueue(node, p);
+  else
+    enqueue(&node->priorityQueues[p->effectivePriority - 1], p);
+}
+
+// Admission control: every enabled policy gets a say when a process arrives, before it
+// becomes runnable. A policy returns ADMIT_*; one that defers sets *retryTick.
+typedef int (*admission_check)(sim_node *node, process *p, int *retryTick);
+
+// At most queueCap runnable processes per priority
+static int admitQueueCap(sim_node *node, process *p, int *retryTick)
+{
+  (void)retryTick;
+  int cap = node->config.admission.queueCap[p->priority - 1];
+  if (cap <= 0)
+    return ADMIT_ACCEPT;
+
+  int queued;
+  if (node->policy == HPF_POLICY_CFS)
+    queued = node->cfs.queued[p->priority - 1];
+  else
+    queued = node->priorityQueues[p->priority - 1].count;
+  return queued >= cap ? ADMIT_REJECT : ADMIT_ACCEPT;
+}
+
+// Estimated wait = CPU work that runs before p. Under HPF: everything queued at its
+// priority or above, plus whatever the running process keeps the CPU for. Under CFS
+// everyone shares the CPU, so it is the other processes' weighted share of all the work.
+static int admitEstimatedWait(sim_node *node, process *p, int *retryTick)
+{
+  (void)retryTick;
+  float limit = node->config.admission.maxWait[p->priority - 1];
+  if (limit <= 0)
+    return ADMIT_ACCEPT;
+
+  process *running = node->currentProcess;
+  float work = 0;
+  if (node->policy == HPF_POLICY_CFS)
+  {
+    long otherWeight = node->cfs.totalWeight;
+    work = node->cfs.work;
+    if (running != NULL)
+    {
+      work += running->remainingTime;
+      otherWeight += cfsWeights[running->effectivePriority - 1];
+    }
+    work *= otherWeight / (float)(otherWeight + cfsWeights[p->priority - 1]);
+  }
+  else
+  {
+    for (int i = 0; i < p->priority; i++)
+    {
+      work += node->priorityQueues[i].work;
+    }
+    if (running != NULL && running->effectivePriority <= p->priority)
+      work += running->remainingTime;
+    else if (running != NULL && node->policy == HPF_POLICY_NON_PREEMPTIVE)
+      work += running->burstRemaining;
+  }
+  return work > limit ? ADMIT_REJECT : ADMIT_ACCEPT;
+}
+
+// Token bucket per priority: tokenRate tokens per quantum, up to bucketSize banked. A
+// process that finds the bucket empty comes back when the next token is due.
+static int admitTokenBucket(sim_node *node, process *p, int *retryTick)
+{
+  int level = p->priority - 1;
+  float rate = node->config.admission.tokenRate[level];
+  if (rate <= 0)
+    return ADMIT_ACCEPT;
+
+  float bucketSize = node->config.admission.bucketSize[level];
+  float size = bucketSize > 1.0f ? bucketSize : 1.0f;
+  node->tokens[level] += rate * (node->currentTime - node->tokensAt[level]);
+  if (node->tokens[level] > size)
+    node->tokens[level] = size;
+  node->tokensAt[level] = node->currentTime;
+
+  if (node->tokens[level] >= 1.0f)
+  {
+    node->tokens[level] -= 1.0f;
+    return ADMIT_ACCEPT;
+  }
+
+  int wait = (int)ceilf((1.0f - node->tokens[level]) / rate);
+  *retryTick = node->currentTime + (wait > 1 ? wait : 1);
+  return ADMIT_DEFER;
+}
+
+// Indexed by ADMISSION_* bit
+static const admission_check admissionChecks[NUM_ADMISSION_POLICIES] = {admitQueueCap, admitEstimatedWait,
+                                                                  admitTokenBucket};
+
+// The first enabled policy that doesn't accept decides
+static int admit(sim_node *node, process *p, int *retryTick)
+{
+  for (int i = 0; i < NUM_ADMISSION_POLICIES; i++)
+  {
+    if (!(node->admissionPolicies & (1 << i)))
+      continue;
+
+    int verdict = admissionChecks[i](node, p, retryTick);
+    if (verdict != ADMIT_ACCEPT)
+      return verdict;
+  }
+  return ADMIT_ACCEPT;
+}
+
+static void onArrival(process *p, void *ctx)
+{
+  sim_node *node = ctx;
+  int retryTick = 0;
+
+  p->admission = admit(node, p, &retryTick);
+  // Coming back after quanta > 99 it could never start, so that is a rejection too
+  if (p->admission == ADMIT_DEFER && retryTick > MAX_QUANTA)
+    p->admission = ADMIT_REJECT;
+
+  if (p->admission == ADMIT_REJECT)
+  {
+    LOG(node, "%d\t%c\t%d\t\t%.1f\t\tRejected\n",
+        node->currentTime, p->processName, p->priority, p->remainingTime);
+    return;
+  }
+  if (p->admission == ADMIT_DEFER)
+  {
+    p->timesDeferred++;
+    wheelInsertAt(&node->arrivalWheel, p, retryTick);
+    LOG(node, "%d\t%c\t%d\t\t%.1f\t\tDeferred\n",
+        node->currentTime, p->processName, p->priority, p->remainingTime);
+    return;
+  }
+
+  // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
+  // Waiting starts at the arrival itself, not the tick that handles it (time spent deferred
+  // by admission control counts as waiting too)
+  makeRunnable(node, p, p->arrivalTime);
+  LOG(node, "%d\t%c\t%d\t\t%.1f\t\tArrived\n",
+      node->currentTime, p->processName, p->priority, p->remainingTime);
+}
+
+// Put every generated process on the arrival wheel
+static void scheduleArrivals(sim_node *node)
+{
+  // The sorted order keeps same-tick arrivals in arrival order
+  for (int i = 0; i < node->numProcesses; i++)
+  {
+    if (node->processList[i].arrivalTime < MAX_QUANTA)
+      wheelInsert(&node->arrivalWheel, &node->processList[i]);
+  }
+}
+
+// Send the process to its next I/O burst at time `now`; it queues behind the device's
+// earlier requests and blocks until the device is done with it
+static void issueIo(sim_node *node, process *p, float now)
+{
+  p->burstIndex++;
+  io_device *device = &node->devices[(p->processId + p->burstIndex) % node->config.io.numDevices];
+  float serviceTime = p->bursts[p->burstIndex];
+  float start = device->busyUntil > now ? device->busyUntil : now;
+
+  device->queueingDelay += start - now;
+  device->busyUntil = start + serviceTime;
+  device->busyTime += serviceTime;
+  device->requests++;
+
+  p->wakeupTime = device->busyUntil;
+  p->ioWaitTime += p->wakeupTime - now;
+  blockedPush(&node->blocked, p);
+}
+
+static int anyDeviceBusy(sim_node *node, int time)
+{
+  for (int d = 0; d < node->config.io.numDevices; d++)
+  {
+    if (node->devices[d].busyUntil > time)
+      return 1;
+  }
+  return 0;
+}
+
+// Lock util functions
+
+// Raise a lock holder to `priority`, moving it between ready queues if it is waiting in one
+static void boostPriority(sim_node *node, process *p, int priority)
+{
+  if (priority >= p->effectivePriority)
+    return;
+
+  if (removeFromQueue(&node->priorityQueues[p->effectivePriority - 1], p))
+  {
+    p->effectivePriority = priority;
+    enqueue(&node->priorityQueues[priority - 1], p);
+  }
+  else
+  {
+    // Running, or blocked on I/O: the new level applies when it is next queued
+    p->effectivePriority = priority;
+  }
+}
+
+static void grantLock(sim_node *node, sim_lock *lock, process *p)
+{
+  lock->holder = p;
+  p->lockState = LOCK_HOLDING;
+
+  if (node->lockProtocol == LOCK_PROTOCOL_CEILING && lock->ceiling < p->effectivePriority)
+    p->effectivePriority = lock->ceiling;
+
+  // Inheritance: the new holder already has waiters behind it
+  if (node->lockProtocol == LOCK_PROTOCOL_INHERIT)
+  {
+    for (int i = 0; i < lock->numWaiters; i++)
+    {
+      if (lock->waiters[i]->effectivePriority < p->effectivePriority)
+        p->effectivePriority = lock->waiters[i]->effectivePriority;
+    }
+  }
+}
+
+// Called before p runs a quantum. 0 if p needed the lock and is now waiting for it.
+static int acquireLockIfDue(sim_node *node, process *p)
+{
+  if (p->lockId < 0 || p->lockState != LOCK_NOT_TAKEN ||
+      p->expectedRunTime - p->remainingTime < p->lockAcquireAt)
+    return 1;
+
+  sim_lock *lock = &node->locks[p->lockId];
+  if (lock->holder == NULL)
+  {
+    grantLock(node, lock, p);
+    return 1;
+  }
+
+  lock->waiters[lock->numWaiters++] = p;
+  p->lockBlockedSince = node->currentTime;
+  LOG(node, "%d\t%c\t%d\t\t%.1f\t\tLock Wait\n",
+      node->currentTime, p->processName, p->priority, p->remainingTime);
+
+  if (node->lockProtocol == LOCK_PROTOCOL_INHERIT)
+    boostPriority(node, lock->holder, p->effectivePriority);
+  return 0;
+}
+
+// Give the lock back (at `now`) and hand it straight to the best waiter
+static void releaseLock(sim_node *node, process *p, int now)
+{
+  sim_lock *lock = &node->locks[p->lockId];
+  lock->holder = NULL;
+  p->lockState = LOCK_RELEASED;
+  p->effectivePriority = p->priority;
+
+  if (lock->numWaiters == 0)
+    return;
+
+  int best = 0;
+  for (int i = 1; i < lock->numWaiters; i++)
+  {
+    if (lock->waiters[i]->effectivePriority < lock->waiters[best]->effectivePriority)
+      best = i;
+  }
+
+  process *next = lock->waiters[best];
+  for (int i = best; i < lock->numWaiters - 1; i++)
+  {
+    lock->waiters[i] = lock->waiters[i + 1];
+  }
+  lock->numWaiters--;
+
+  next->lockBlockedTime += now - next->lockBlockedSince;
+  grantLock(node, lock, next);
+  makeRunnable(node, next, now);
+  LOG(node, "%d\t%c\t%d\t\t%.1f\t\tLock Acquired\n",
+      now, next->processName, next->priority, next->remainingTime);
+}
+
+// Everyone waiting on a lock while the CPU runs at a lower effective priority than theirs
+// is suffering inversion. A holder boosted by inheritance or the ceiling runs at the
+// waiter's level, so that time counts as blocking but not as inversion.
+static void accountInversion(sim_node *node, process *running)
+{
+  for (int l = 0; l < node->config.locks.numLocks; l++)
+  {
+    for (int i = 0; i < node->locks[l].numWaiters; i++)
+    {
+      if (running->effectivePriority > node->locks[l].waiters[i]->effectivePriority)
+        node->locks[l].waiters[i]->inversionTime += 1.0f;
+    }
+  }
+}
+
+// Timeline util functions
+
+static void laneAppend(timeline_lane *lane, const void *bytes, size_t n)
+{
+  if (lane->length + n > lane->capacity)
+  {
+    lane->capacity = lane->capacity * 2 + n + 256;
+    lane->data = realloc(lane->data, lane->capacity);
+  }
+  memcpy(lane->data + lane->length, bytes, n);
+  lane->length += n;
+}
+
+// LEB128: 7 bits per byte, high bit set on all but the last
+static void laneAppendVarint(timeline_lane *lane, unsigned int value)
+{
+  unsigned char bytes[5];
+  int n = 0;
+  do
+  {
+    bytes[n] = value & 0x7f;
+    value >>= 7;
+    if (value != 0)
+      bytes[n] |= 0x80;
+    n++;
+  } while (value != 0);
+  laneAppend(lane, bytes, n);
+}
+
+// Close the open segment. `next` is whoever runs next (NULL at the end); a slice that
+// ends with a higher priority process taking over straight away was really a preemption.
+static void timelineClose(sim_node *node, process *next)
+{
+  timeline_lane *lane = node->timeline;
+  if (lane->p == NULL)
+    return;
+
+  int reason = lane->reason;
+  if (reason == SEGMENT_SLICE && node->policy != HPF_POLICY_CFS && next != NULL &&
+      next->effectivePriority < lane->p->effectivePriority)
+    reason = SEGMENT_PREEMPT;
+
+  if (timelineConfig.binary)
+  {
+    // gap, length, pid, then priority (2 bits) and reason (3 bits) in one byte
+    unsigned char packed = (lane->p->priority - 1) | (reason << 2);
+    laneAppendVarint(lane, lane->start - lane->lastEnd);
+    laneAppendVarint(lane, lane->end - lane->start);
+    laneAppendVarint(lane, lane->p->processId);
+    laneAppend(lane, &packed, 1);
+  }
+  else
+  {
+    char line[96];
+    int n = snprintf(line, sizeof(line), "%d %d %d %d %c %d %s\n", lane->start, lane->end, node->nodeId,
+                     lane->p->processId, lane->p->processName, lane->p->priority, segmentReasons[reason]);
+    laneAppend(lane, line, n);
+  }
+
+  lane->segments++;
+  lane->lastEnd = lane->end;
+  lane->p = NULL;
+}
+
+// p runs the quantum starting at `tick`: extend its segment, or close the last one and start anew
+static void timelineRun(sim_node *node, process *p, int tick)
+{
+  timeline_lane *lane = node->timeline;
+  if (lane == NULL)
+    return;
+
+  if (lane->p == p && lane->end == tick)
+  {
+    lane->end = tick + 1;
+    lane->reason = SEGMENT_END;
+    return;
+  }
+
+  timelineClose(node, lane->end == tick ? p : NULL);
+  lane->p = p;
+  lane->start = tick;
+  lane->end = tick + 1;
+  lane->reason = SEGMENT_END;
+}
+
+// The process of the open segment left the CPU; the segment stays open in case it is
+// picked again for the very next quantum
+static void timelineStop(sim_node *node, process *p, int reason)
+{
+  if (node->timeline != NULL && node->timeline->p == p)
+    node->timeline->reason = reason;
+}
+
+// CFS: the leftmost (least vruntime) process runs for its weighted share of targetLatency
+static void cfsSelectNext(sim_node *node)
+{
+  while (node->cfs.leftmost != NULL)
+  {
+    process *next = node->cfs.leftmost;
+    cfsDequeue(node, next);
+
+    // Same rule as HPF: nothing starts for the first time after quanta > 99
+    if (next->startTime < 0 && node->currentTime > MAX_QUANTA)
+      continue;
+
+    if (next->vruntime > node->minVruntime)
+      node->minVruntime = next->vruntime;
+    next->waitingTime += node->currentTime - next->readySince;
+
+    cfs_config *cfs = &node->config.cfs;
+    float slice = cfs->targetLatency * next->weight / (float)(node->cfs.totalWeight + next->weight);
+    node->sliceLeft = slice > cfs->minGranularity ? slice : cfs->minGranularity;
+    node->currentProcess = next;
+
+    if (next->startTime < 0)
+    {
+      next->startTime = node->currentTime;
+    }
+    LOG(node, "%d\t%c\t%d\t\t%.1f\t\tStart\n",
+        node->currentTime, next->processName, next->priority, next->remainingTime);
+    return;
+  }
+}
+
+// Select next process if no current process
+static void selectNext(sim_node *node)
+{
+  pqueue *priorityQueues = node->priorityQueues;
+
+  if (node->policy == HPF_POLICY_CFS)
+  {
+    cfsSelectNext(node);
+    return;
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    if (priorityQueues[i].count > 0)
+    {
+      // Check if it's the first time a process ran after quanta > 99
+      // DO NOT dequeue yet
+      process *tempProc = priorityQueues[i].processes[priorityQueues[i].front];
+
+      if (tempProc->startTime < 0 && node->currentTime > MAX_QUANTA)
+      {
+        continue;
+      }
+
+      process *currentProcess = dequeue(&priorityQueues[i]);
+      node->currentProcess = currentProcess;
+      currentProcess->waitingTime += node->currentTime - currentProcess->readySince;
+
+      if (currentProcess->startTime < 0)
+      {
+        currentProcess->startTime = node->currentTime;
+      }
+      // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
+      LOG(node, "%d\t%c\t%d\t\t%.1f\t\tStart\n",
+          node->currentTime, currentProcess->processName,
+          currentProcess->priority, currentProcess->remainingTime);
+      break;
+    }
+  }
+}
+
+// HPF Scheduling, run until `windowEnd` (or until the node goes quiet). Queues are picked
+// by effectivePriority, which only differs from priority while a lock protocol boosts it.
+static void hpf_step(sim_node *node, int windowEnd)
+{
+  pqueue *priorityQueues = node->priorityQueues;
+
+  while (node->currentTime < windowEnd && node->currentTime < MAX_QUANTA * 2)
+  {
+    // Allow completion beyond 100 quanta
+    wheelAdvance(&node->arrivalWheel, node->currentTime, onArrival, node);
+
+    // Finished I/O goes back to the rear of its priority queue
+    while (node->blocked.count > 0 && node->blocked.processes[0]->wakeupTime <= node->currentTime)
+    {
+      process *p = blockedPop(&node->blocked);
+      p->burstIndex++;
+      p->burstRemaining = p->bursts[p->burstIndex];
+      makeRunnable(node, p, node->currentTime);
+      LOG(node, "%d\t%c\t%d\t\t%.1f\t\tI/O Done\n",
+          node->currentTime, p->processName, p->priority, p->remainingTime);
+    }
+
+    // Check if current process should be preempted
+    if (node->policy == HPF_POLICY_PREEMPTIVE && node->currentProcess != NULL)
+    {
+      process *currentProcess = node->currentProcess;
+      // Check if a higher priority process has arrived
+      for (int i = 0; i < currentProcess->effectivePriority - 1; i++)
+      {
+        if (priorityQueues[i].count > 0)
+        {
+          // Preempt current process
+          // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
+          LOG(node, "%d\t%c\t%d\t\t%.1f\t\tPreempt\n",
+              node->currentTime, currentProcess->processName,
+              currentProcess->priority, currentProcess->remainingTime);
+
+          makeRunnable(node, currentProcess, node->currentTime);
+          timelineStop(node, currentProcess, SEGMENT_PREEMPT);
+          currentProcess->timesPreempted++;
+          node->totalPreemptions++;
+          node->currentProcess = NULL;
+          break;
+        }
+      }
+    }
+
+    if (node->currentProcess == NULL)
+      selectNext(node);
+
+    // A process reaching its lock while someone else holds it blocks; pick again
+    while (node->currentProcess != NULL && !acquireLockIfDue(node, node->currentProcess))
+    {
+      timelineStop(node, node->currentProcess, SEGMENT_LOCK);
+      node->currentProcess = NULL;
+      selectNext(node);
+    }
+
+    if (anyDeviceBusy(node, node->currentTime))
+    {
+      node->deviceBusyTime++;
+      if (node->currentProcess != NULL)
+        node->overlapTime++;
+    }
+
+    if (node->currentProcess != NULL)
+    {
+      process *currentProcess = node->currentProcess;
+      // run process for 1 quantum
+      timelineRun(node, currentProcess, node->currentTime);
+      currentProcess->remainingTime -= 1.0f;
+      currentProcess->burstRemaining -= 1.0f;
+      node->cpuBusyTime++;
+      accountInversion(node, currentProcess);
+      currentProcess->vruntime += 1024.0 / cfsWeights[currentProcess->effectivePriority - 1];
+      node->sliceLeft -= 1.0f;
+
+      int lastBurst = currentProcess->burstIndex == currentProcess->numBursts - 1;
+      if (currentProcess->lockState == LOCK_HOLDING &&
+          (currentProcess->expectedRunTime - currentProcess->remainingTime >= currentProcess->lockReleaseAt ||
+           (lastBurst && currentProcess->burstRemaining <= 0)))
+      {
+        releaseLock(node, currentProcess, node->currentTime + 1);
+      }
+
+      if (currentProcess->burstRemaining <= 0 && !lastBurst)
+      {
+        // CPU burst done, off to I/O
+        LOG(node, "%d\t%c\t%d\t\t%.1f\t\tBlocked\n",
+            node->currentTime, currentProcess->processName,
+            currentProcess->priority, currentProcess->remainingTime);
+        issueIo(node, currentProcess, node->currentTime + 1);
+        timelineStop(node, currentProcess, SEGMENT_IO);
+        node->currentProcess = NULL;
+        node->idleTime = 0;
+      }
+      else if (currentProcess->burstRemaining <= 0)
+      {
+        // Process completed
+        timelineStop(node, currentProcess, SEGMENT_COMPLETE);
+        // It finishes at the end of this quantum; the next tick is simulated as usual, so
+        // arrivals, wakeups and device time in it are not lost
+        currentProcess->finishTime = node->currentTime + 1;
+        // turnaroundtime = finish - arrival (waitingTime was summed up as it left the ready queue)
+        currentProcess->turnaroundTime = currentProcess->finishTime - currentProcess->arrivalTime;
+
+        // Time (in Quanta) -> Process Name -> Proc Priority Level -> Remaining Quanta till Completion -> Current Status
+        LOG(node, "%d\t%c\t%d\t\t%.1f\t\tComplete\n",
+            node->currentTime + 1, currentProcess->processName,
+            currentProcess->priority, currentProcess->remainingTime);
+
+        onProcessComplete(node, currentProcess);
+        node->currentProcess = NULL;
+        node->idleTime = 0;
+      }
+      else if (node->policy == HPF_POLICY_PREEMPTIVE)
+      {
+        // current process --> back to rear of its priority queue (RR)
+        makeRunnable(node, currentProcess, node->currentTime + 1);
+        timelineStop(node, currentProcess, SEGMENT_SLICE);
+        node->currentProcess = NULL;
+      }
+      else if (node->policy == HPF_POLICY_CFS && node->sliceLeft <= 0)
+      {
+        // Slice used up: back into the tree at its new vruntime
+        makeRunnable(node, currentProcess, node->currentTime + 1);
+        timelineStop(node, currentProcess, SEGMENT_SLICE);
+        node->currentProcess = NULL;
+      }
+      // Non-preemptive: keeps the CPU for the rest of its burst
+    }
+    else
+    {
+      // CPU is idle
+      node->idleTime++;
+      if (node->idleTime <= 2)
+        LOG(node, "%d\t-\t-\t\t-\t\tIdle\n", node->currentTime);
       // Break if idle for too long and no more processes can arrive
-      if (idleTime > 2 && processIndex >= numProcesses)
+      if (node->idleTime > 2 && node->arrivalWheel.pending == 0 && node->blocked.count == 0)
         break;
     }
 
-    currentTime++;
+    node->currentTime++;
+  }
+}
+
+// Library API (hpf_sim.h): a hpf_sim is one quiet node
+struct hpf_sim
+{
+  sim_node node;
+};
+
+hpf_sim *hpf_sim_create(const hpf_config *config)
+{
+  hpf_sim *sim = malloc(sizeof(hpf_sim));
+  if (sim == NULL)
+    return NULL;
+
+  initNode(&sim->node, 0, config->maxProcesses > 0 ? config->maxProcesses : 1, config->seed);
+  sim->node.policy = config->policy;
+  sim->node.lockProtocol = config->lockProtocol;
+  sim->node.admissionPolicies = config->admissionPolicies;
+  if (sim->node.processList == NULL || sim->node.blocked.processes == NULL)
+  {
+    hpf_sim_destroy(sim);
+    return NULL;
+  }
+  return sim;
+}
+
+void hpf_sim_destroy(hpf_sim *sim)
+{
+  if (sim == NULL)
+    return;
+  freeNode(&sim->node);
+  free(sim);
+}
+
+void hpf_sim_reset(hpf_sim *sim, unsigned int seed)
+{
+  resetNode(&sim->node, seed);
+}
+
+int hpf_sim_generate(hpf_sim *sim, int count)
+{
+  generate_proc(&sim->node, count);
+  return sim->node.numProcesses;
+}
+
+int hpf_sim_add_process(hpf_sim *sim, float arrivalTime, float runTime, int priority)
+{
+  process *simProcess = addProcess(&sim->node, arrivalTime, runTime, priority);
+  return simProcess != NULL ? simProcess->processId : -1;
+}
+
+int hpf_sim_run(hpf_sim *sim)
+{
+  // The finished processes would go back on the arrival wheel
+  if (sim->node.currentTime != 0)
+    return -1;
+  scheduleArrivals(&sim->node);
+  hpf_step(&sim->node, MAX_QUANTA * 2);
+  return sim->node.currentTime;
+}
+
+void hpf_sim_stats(hpf_sim *sim, priority_stats *out)
+{
+  calculatePriorityStats(out, &sim->node, 1);
+}
+
+const process *hpf_sim_processes(hpf_sim *sim, int *count)
+{
+  *count = sim->node.numProcesses;
+  return sim->node.processList;
+}
+
+// Everything below is the command line program (modes, server, main)
+#ifndef HPF_NO_MAIN
+static const char *policyNames[3] = {"HPF Preemptive", "HPF Non-Preemptive", "CFS"};
+static const char *lockProtocolNames[3] = {"No Protocol", "Priority Inheritance", "Priority Ceiling"};
+static const char *admissionNames[NUM_ADMISSION_POLICIES] = {"cap", "wait", "bucket"};
+
+// Processes generated per run (--processes), more than the CPU can finish overloads it
+static int generatedProcesses = NUM_PROCESSES;
+
+// Adaptive trial mode knobs
+typedef struct adaptive_config
+{
+  int enabled;
+  float precision; // target CI half-width relative to the mean
+  int minTrials;
+  int maxTrials;
+  int metricMask;  // bit per metric, see metricNames
+} adaptive_config;
+
+#define NUM_METRICS 5
+// Trials between convergence checks. Fixed, so the stopping point doesn't depend on --threads
+#define ADAPTIVE_BATCH 64
+static const char *metricNames[NUM_METRICS] = {"turnaround", "waiting", "response", "throughput", "completed"};
+
+static adaptive_config adaptiveConfig = {0, 0.05f, 20, 10000, (1 << NUM_METRICS) - 1};
+
+static void printPriorityStats(priority_stats *ps, const char *algorithmName)
+{
+  printf("\n=== %s PQueue Statistics ===\n", algorithmName);
+
+  // Print statistics for each priority queue
+  for (int priority = 0; priority < 4; priority++)
+  {
+    printf("\n--- Priority %d Statistics ---\n", priority + 1);
+    printf("Total Processes Completed: %d\n", ps->priorityStats[priority].totalProcesses);
+    if (hpf_admission.policies)
+    {
+      printf("Rejected (admission): %d\n", ps->priorityStats[priority].rejectedProcesses);
+      printf("Deferred (admission): %d\n", ps->priorityStats[priority].deferredProcesses);
+    }
+
+    if (ps->priorityStats[priority].totalProcesses > 0)
+    {
+      printf("Avg. Turnaround Time: %.2f quanta\n", ps->priorityStats[priority].avgTurnaroundTime);
+      printf("Avg. Waiting Time: %.2f quanta\n", ps->priorityStats[priority].avgWaitingTime);
+      if (hpf_admission.policies)
+        printf("P99 Waiting Time: %.2f quanta\n", ps->priorityStats[priority].p99WaitingTime);
+      printf("Avg. Response Time: %.2f quanta\n", ps->priorityStats[priority].avgResponseTime);
+      if (hpf_io.enabled)
+        printf("Avg. I/O Wait Time: %.2f quanta\n", ps->priorityStats[priority].avgIoWaitTime);
+      if (hpf_locks.numLocks > 0)
+      {
+        printf("Avg. Lock Blocked Time: %.2f quanta\n", ps->priorityStats[priority].avgLockBlockedTime);
+        printf("Avg. Priority Inversion: %.2f quanta (max %.2f)\n",
+               ps->priorityStats[priority].avgInversionTime, ps->priorityStats[priority].maxInversionTime);
+      }
+      printf("Throughput: %.2f processes/quantum\n", ps->priorityStats[priority].throughput);
+    }
+    else
+    {
+      printf("N/A (starvation)\n");
+      printf("Avg Turnaround Time: N/A\n");
+      printf("Avg Waiting Time: N/A\n");
+      printf("Avg Response Time: N/A\n");
+      printf("Throughput: N/A\n");
+    }
+  }
+
+  // Print overall statistics
+  printf("\n--- Overall Statistics ---\n");
+  printf("Total Processes Completed: %d\n", ps->overallStats.totalProcesses);
+  if (hpf_admission.policies)
+  {
+    printf("Rejected (admission): %d\n", ps->overallStats.rejectedProcesses);
+    printf("Deferred (admission): %d\n", ps->overallStats.deferredProcesses);
+  }
+  printf("Avg Turnaround Time: %.2f quanta\n", ps->overallStats.avgTurnaroundTime);
+  printf("Avg Waiting Time: %.2f quanta\n", ps->overallStats.avgWaitingTime);
+  if (hpf_admission.policies)
+    printf("P99 Waiting Time: %.2f quanta\n", ps->overallStats.p99WaitingTime);
+  printf("Avg Response Time: %.2f quanta\n", ps->overallStats.avgResponseTime);
+  if (hpf_io.enabled)
+    printf("Avg I/O Wait Time: %.2f quanta\n", ps->overallStats.avgIoWaitTime);
+  if (hpf_locks.numLocks > 0)
+  {
+    printf("Avg Lock Blocked Time: %.2f quanta\n", ps->overallStats.avgLockBlockedTime);
+    printf("Avg Priority Inversion: %.2f quanta (max %.2f)\n",
+           ps->overallStats.avgInversionTime, ps->overallStats.maxInversionTime);
+  }
+  printf("Throughput: %.2f processes/quantum\n", ps->overallStats.throughput);
+}
+
+// Nothing running, nothing left to arrive or wake up: the scheduler loop would stop here
+static int nodeQuiescent(sim_node *node)
+{
+  return node->currentProcess == NULL && node->idleTime > 2 &&
+         node->arrivalWheel.pending == 0 && node->blocked.count == 0;
+}
+
+static void timelineOpen(sim_node *node)
+{
+  node->timeline = calloc(1, sizeof(timeline_lane));
+}
+
+// Write every node's lane, in node order. Text: one "start end lane pid name priority reason"
+// line per segment. Binary: "HPFT", version, lane count, then per lane its id, segment count
+// and the varint records.
+static int writeTimeline(sim_node *nodes, int numNodes)
+{
+  FILE *out = fopen(timelineConfig.path, timelineConfig.binary ? "wb" : "w");
+  if (out == NULL)
+  {
+    perror(timelineConfig.path);
+    return -1;
+  }
+
+  size_t bytes = 0;
+  long segments = 0;
+  timeline_lane header = {0};
+  if (timelineConfig.binary)
+  {
+    unsigned char magic[5] = {'H', 'P', 'F', 'T', 1};
+    laneAppend(&header, magic, sizeof(magic));
+    laneAppendVarint(&header, numNodes);
+  }
+  else
+  {
+    const char *columns = "# start end lane pid name priority reason\n";
+    laneAppend(&header, columns, strlen(columns));
+  }
+  fwrite(header.data, 1, header.length, out);
+  bytes += header.length;
+
+  for (int n = 0; n < numNodes; n++)
+  {
+    timeline_lane *lane = nodes[n].timeline;
+    timelineClose(&nodes[n], NULL);
+    if (timelineConfig.binary)
+    {
+      header.length = 0;
+      laneAppendVarint(&header, nodes[n].nodeId);
+      laneAppendVarint(&header, lane->segments);
+      fwrite(header.data, 1, header.length, out);
+      bytes += header.length;
+    }
+    fwrite(lane->data, 1, lane->length, out);
+    bytes += lane->length;
+    segments += lane->segments;
+  }
+  free(header.data);
+  fclose(out);
+
+  printf("\nTimeline: %ld segments, %zu bytes -> %s\n", segments, bytes, timelineConfig.path);
+  return 0;
+}
+
+// Scheduling of a single node under node->policy
+static void hpf_run(sim_node *node, const char *algorithmName)
+{
+  priority_stats schedulerStats = {0};
+
+  // Everything generated up front goes through the wheel too
+  scheduleArrivals(node);
+
+  LOG(node, "\n%s Scheduling \n", algorithmName);
+  LOG(node, "Time\tPID\tPriority Lvl\tRemaining\tStatus\n");
+
+  hpf_step(node, MAX_QUANTA * 2);
+
+  calculatePriorityStats(&schedulerStats, node, 1);
+  printPriorityStats(&schedulerStats, algorithmName);
+
+  if (hpf_workload.closedLoop)
+  {
+    printf("\n--- Closed Loop ---\n");
+    printf("Resubmitted: %d\n", node->resubmittedProcesses);
+    printf("Spawned: %d\n", node->spawnedProcesses);
+    printf("Dropped (process table full): %d\n", node->droppedProcesses);
+    printf("Cut off (arriving after quantum %d): %d\n", MAX_QUANTA, node->cutOffProcesses);
+  }
+}
+
+// The comparison modes run the same workload (same seed) on one node per variant.
+// `configure` sets what the variant changes; each run is printed as usual, headed by
+// prefix + its name. `results` (if not NULL) gets each node's per-priority stats.
+static void runComparison(sim_node *nodes, int count, const char *const *names, const char *prefix,
+                          void (*configure)(sim_node *node, int variant), priority_stats *results,
+                          unsigned int seed, int verbose)
+{
+  for (int i = 0; i < count; i++)
+  {
+    char algorithmName[64];
+    snprintf(algorithmName, sizeof(algorithmName), "%s%s", prefix, names[i]);
+
+    initNode(&nodes[i], i, generatedProcesses * PROCESS_POOL_FACTOR, seed);
+    nodes[i].verbose = verbose;
+    configure(&nodes[i], i);
+    if (timelineConfig.path != NULL)
+      timelineOpen(&nodes[i]);
+    generate_proc(&nodes[i], generatedProcesses);
+    hpf_run(&nodes[i], algorithmName);
+    if (results != NULL)
+      calculatePriorityStats(&results[i], &nodes[i], 1);
+  }
+}
+
+// One row per priority (then Overall) and variant; `columns` prints the cells after the
+// variant's name
+static void printComparison(priority_stats *results, int count, const char *const *names, int nameWidth,
+                            void (*columns)(stats *st))
+{
+  for (int priority = 0; priority < 5; priority++)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      stats *st = priority < 4 ? &results[i].priorityStats[priority] : &results[i].overallStats;
+      char label[16];
+      if (priority < 4)
+        snprintf(label, sizeof(label), "%d", priority + 1);
+      else
+        snprintf(label, sizeof(label), "Overall");
+
+      printf("%-10s%-*s", label, nameWidth, names[i]);
+      columns(st);
+      printf("\n");
+    }
+  }
+}
+
+static void endComparison(sim_node *nodes, int count)
+{
+  if (timelineConfig.path != NULL)
+    writeTimeline(nodes, count);
+
+  for (int i = 0; i < count; i++)
+  {
+    freeNode(&nodes[i]);
+  }
+}
+
+static void configureHpfVariant(sim_node *node, int variant)
+{
+  node->policy = variant == 0 ? HPF_POLICY_PREEMPTIVE : HPF_POLICY_NON_PREEMPTIVE;
+}
+
+// I/O mode: the same workload (same seed) under both HPF variants, then how each one
+// kept the CPU busy while the devices were working
+static void hpf_io_comparison(unsigned int seed, int verbose)
+{
+  const char *names[2] = {"HPF Preemptive", "HPF Non-Preemptive"};
+  sim_node nodes[2];
+  runComparison(nodes, 2, names, "", configureHpfVariant, NULL, seed, verbose);
+
+  printf("\n=== CPU / I-O Overlap (%d device%s) ===\n", hpf_io.numDevices, hpf_io.numDevices > 1 ? "s" : "");
+  printf("%-32s%-20s%-20s\n", "", names[0], names[1]);
+
+  float utilization[2], deviceUtilization[2], overlap[2], queueing[2];
+  int requests[2];
+  for (int i = 0; i < 2; i++)
+  {
+    sim_node *node = &nodes[i];
+    float deviceBusy = 0, queueingDelay = 0;
+    requests[i] = 0;
+    for (int d = 0; d < hpf_io.numDevices; d++)
+    {
+      deviceBusy += node->devices[d].busyTime;
+      queueingDelay += node->devices[d].queueingDelay;
+      requests[i] += node->devices[d].requests;
+    }
+
+    float elapsed = node->currentTime > 0 ? node->currentTime : 1;
+    utilization[i] = 100.0f * node->cpuBusyTime / elapsed;
+    deviceUtilization[i] = 100.0f * deviceBusy / (elapsed * hpf_io.numDevices);
+    // Share of the quanta with I/O in flight during which the CPU was doing work too
+    overlap[i] = node->deviceBusyTime > 0 ? 100.0f * node->overlapTime / node->deviceBusyTime : 0;
+    queueing[i] = requests[i] > 0 ? queueingDelay / requests[i] : 0;
+  }
+
+  printf("%-32s%-20d%-20d\n", "Elapsed (quanta)", nodes[0].currentTime, nodes[1].currentTime);
+  printf("%-32s%-20.1f%-20.1f\n", "CPU Utilization (%)", utilization[0], utilization[1]);
+  printf("%-32s%-20.1f%-20.1f\n", "Device Utilization (%)", deviceUtilization[0], deviceUtilization[1]);
+  printf("%-32s%-20.1f%-20.1f\n", "CPU/I-O Overlap (%)", overlap[0], overlap[1]);
+  printf("%-32s%-20d%-20d\n", "I/O Requests", requests[0], requests[1]);
+  printf("%-32s%-20.2f%-20.2f\n", "Avg Device Queueing (quanta)", queueing[0], queueing[1]);
+  endComparison(nodes, 2);
+}
+
+static void configureLockVariant(sim_node *node, int variant)
+{
+  node->lockProtocol = variant;
+}
+
+static void lockColumns(stats *st)
+{
+  if (st->totalProcesses == 0)
+    printf("%-14s%-14s%-14s%-14s", "N/A", "N/A", "N/A", "N/A");
+  else
+    printf("%-14.2f%-14.2f%-14.2f%-14.2f", st->avgTurnaroundTime, st->avgLockBlockedTime, st->avgInversionTime,
+           st->maxInversionTime);
+}
+
+// Lock mode: the same workload (same seed) under each locking protocol
+static void hpf_lock_comparison(unsigned int seed, int verbose)
+{
+  sim_node nodes[3];
+  priority_stats results[3];
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%s, ", policyNames[schedulerPolicy]);
+  runComparison(nodes, 3, lockProtocolNames, prefix, configureLockVariant, results, seed, verbose);
+
+  printf("\n=== Lock Protocols (%d lock%s) ===\n", hpf_locks.numLocks, hpf_locks.numLocks > 1 ? "s" : "");
+  printf("%-10s%-24s%-14s%-14s%-14s%-14s\n", "Priority", "Protocol", "Turnaround", "Lock Blocked",
+         "Inversion", "Max Inversion");
+  printComparison(results, 3, lockProtocolNames, 24, lockColumns);
+  endComparison(nodes, 3);
+}
+
+// Variant i is policy i: HPF_POLICY_PREEMPTIVE, HPF_POLICY_NON_PREEMPTIVE, HPF_POLICY_CFS
+static void configurePolicyVariant(sim_node *node, int variant)
+{
+  node->policy = variant;
+}
+
+static void cfsColumns(stats *st)
+{
+  if (st->totalProcesses == 0)
+    printf("%-12d%-14s%-12s%-12s", 0, "N/A", "N/A", "N/A");
+  else
+    printf("%-12d%-14.2f%-12.2f%-12.2f", st->totalProcesses, st->avgTurnaroundTime, st->avgWaitingTime,
+           st->avgResponseTime);
+}
+
+// CFS vs HPF: the same workload (same seed) under each policy, side by side per priority
+static void hpf_cfs_comparison(unsigned int seed, int verbose)
+{
+  sim_node nodes[3];
+  priority_stats results[3];
+  runComparison(nodes, 3, policyNames, "", configurePolicyVariant, results, seed, verbose);
+
+  printf("\n=== HPF vs CFS (target latency %.1f, min granularity %.1f) ===\n",
+         hpf_cfs.targetLatency, hpf_cfs.minGranularity);
+  printf("%-10s%-20s%-12s%-14s%-12s%-12s\n", "Priority", "Policy", "Completed", "Turnaround", "Waiting", "Response");
+  printComparison(results, 3, policyNames, 20, cfsColumns);
+  endComparison(nodes, 3);
+}
+
+static const int admissionMasks[5] = {0, ADMISSION_QUEUE_CAP, ADMISSION_EST_WAIT, ADMISSION_TOKEN_BUCKET,
+                                      ADMISSION_QUEUE_CAP | ADMISSION_EST_WAIT | ADMISSION_TOKEN_BUCKET};
+static const char *admissionMaskNames[5] = {"None", "Queue Cap", "Estimated Wait", "Token Bucket", "All"};
+
+static void configureAdmissionVariant(sim_node *node, int variant)
+{
+  node->admissionPolicies = admissionMasks[variant];
+}
+
+static void admissionColumns(stats *st)
+{
+  if (st->totalProcesses == 0)
+    printf("%-12d%-10d%-10d%-14s%-14s", 0, st->rejectedProcesses, st->deferredProcesses, "N/A", "N/A");
+  else
+    printf("%-12d%-10d%-10d%-14.2f%-14.2f", st->totalProcesses, st->rejectedProcesses, st->deferredProcesses,
+           st->avgWaitingTime, st->p99WaitingTime);
+}
+
+// Admission control: the same workload (same seed) with no admission control, each policy
+// on its own and all of them together. Overload it (--processes) to see the difference.
+static void hpf_admission_comparison(unsigned int seed, int verbose)
+{
+  sim_node nodes[5];
+  priority_stats results[5];
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%s, Admission: ", policyNames[schedulerPolicy]);
+  runComparison(nodes, 5, admissionMaskNames, prefix, configureAdmissionVariant, results, seed, verbose);
+
+  printf("\n=== Admission Control (%d processes, %s) ===\n", generatedProcesses, policyNames[schedulerPolicy]);
+  printf("%-10s%-18s%-12s%-10s%-10s%-14s%-14s\n", "Priority", "Admission", "Completed", "Rejected",
+         "Deferred", "Avg Waiting", "P99 Waiting");
+  printComparison(results, 5, admissionMaskNames, 18, admissionColumns);
+  endComparison(nodes, 5);
+}
+
+static int rbHeight(process *p)
+{
+  if (p == NULL)
+    return 0;
+  int left = rbHeight(p->rbLeft);
+  int right = rbHeight(p->rbRight);
+  return 1 + (left > right ? left : right);
+}
+
+// Dispatch cost with 10^3 .. maxRunnable processes in the tree: pick leftmost, charge it a
+// slice, put it back. Should grow with log n, not n.
+static void cfsBenchmark(int maxRunnable)
+{
+  const int dispatches = 1000000;
+
+  printf("\nCFS dispatch benchmark (%d dispatches per size)\n", dispatches);
+  printf("%-12s%-14s%-10s\n", "Runnable", "ns/dispatch", "Height");
+
+  for (int n = 1000; n <= maxRunnable; n *= 10)
+  {
+    process *procs = calloc(n, sizeof(process));
+    if (procs == NULL)
+    {
+      printf("%-12d(out of memory)\n", n);
+      break;
+    }
+
+    sim_node node;
+    memset(&node, 0, sizeof(node));
+    unsigned int rng = 1;
+    for (int i = 0; i < n; i++)
+    {
+      procs[i].processId = i;
+      procs[i].priority = procs[i].effectivePriority = 1 + i % 4;
+      procs[i].vruntime = (double)rand_r(&rng) / RAND_MAX * n;
+      cfsEnqueue(&node, &procs[i]);
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int k = 0; k < dispatches; k++)
+    {
+      process *p = node.cfs.leftmost;
+      cfsDequeue(&node, p);
+      if (p->vruntime > node.minVruntime)
+        node.minVruntime = p->vruntime;
+      p->vruntime += hpf_cfs.targetLatency * 1024.0 / p->weight;
+      cfsEnqueue(&node, p);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec);
+    printf("%-12d%-14.1f%-10d\n", n, elapsed / dispatches, rbHeight(node.cfs.root));
+    free(procs);
+
+    if (n > maxRunnable / 10 && n != maxRunnable)
+      n = maxRunnable / 10; // finish on maxRunnable itself
+  }
+}
+
+// Cluster mode: nodes are split into contiguous partitions, one per thread
+typedef struct cluster
+{
+  sim_node *nodes;
+  int numNodes;
+  int numThreads;
+  migration_list *outboxes; // one per partition
+  int *partitionActive;
+  int windows;
+  unsigned int seed;
+  pthread_barrier_t barrier;
+} cluster;
+
+typedef struct partition
+{
+  cluster *c;
+  int id;
+  int firstNode;
+  int lastNode; // exclusive
+  migration_list inbox;
+} partition;
+
+static int compareMigration(const void *a, const void *b)
+{
+  const migration *ma = a;
+  const migration *mb = b;
+  if (ma->dstNode != mb->dstNode)
+    return ma->dstNode - mb->dstNode;
+  if (ma->arrivalTime != mb->arrivalTime)
+    return ma->arrivalTime < mb->arrivalTime ? -1 : 1;
+  if (ma->srcNode != mb->srcNode)
+    return ma->srcNode - mb->srcNode;
+  return ma->seq - mb->seq;
+}
+
+// Hand this partition the jobs sent to its nodes during the last window
+static void deliverMigrations(partition *part)
+{
+  cluster *c = part->c;
+  part->inbox.count = 0;
+
+  for (int src = 0; src < c->numThreads; src++)
+  {
+    migration_list *outbox = &c->outboxes[src];
+    for (int i = 0; i < outbox->count; i++)
+    {
+      if (outbox->items[i].dstNode >= part->firstNode && outbox->items[i].dstNode < part->lastNode)
+        pushMigration(&part->inbox, &outbox->items[i]);
+    }
+  }
+
+  // Canonical order, so the wheels see the same insert order however nodes are partitioned
+  if (part->inbox.count > 0)
+    qsort(part->inbox.items, part->inbox.count, sizeof(migration), compareMigration);
+
+  for (int i = 0; i < part->inbox.count; i++)
+  {
+    migration *m = &part->inbox.items[i];
+    sim_node *node = &c->nodes[m->dstNode];
+    process *simProcess = allocProcess(node);
+    if (simProcess == NULL)
+      continue;
+
+    simProcess->parentId = m->parentId;
+    simProcess->processName = m->processName;
+    simProcess->arrivalTime = m->arrivalTime;
+    simProcess->expectedRunTime = m->expectedRunTime;
+    simProcess->remainingTime = m->expectedRunTime;
+    simProcess->priority = m->priority;
+    simProcess->resubmitsLeft = m->resubmitsLeft;
+    initBursts(node, simProcess);
+    initLockUse(node, simProcess);
+    wheelInsert(&node->arrivalWheel, simProcess);
+    node->migratedIn++;
+  }
+}
+
+// Conservative time windows: a migrated job lands at least migrationDelay quanta after
+// it was sent, so each partition can run a whole window before exchanging jobs.
+static void *clusterWorker(void *arg)
+{
+  partition *part = arg;
+  cluster *c = part->c;
+  int windowStart = 0;
+
+  // Each partition sets up its own nodes. Node n always gets the same seed and workload,
+  // whatever the partitioning, and nobody looks at another partition's nodes before the
+  // first barrier.
+  for (int n = part->firstNode; n < part->lastNode; n++)
+  {
+    sim_node *node = &c->nodes[n];
+    initNode(node, n, clusterConfig.jobsPerNode * PROCESS_POOL_FACTOR, c->seed ^ (n * 2654435761u));
+    node->outbox = &c->outboxes[part->id];
+    if (timelineConfig.path != NULL)
+      timelineOpen(node);
+    generate_proc(node, clusterConfig.jobsPerNode);
+    scheduleArrivals(node);
+  }
+
+  while (1)
+  {
+    int windowEnd = windowStart + clusterConfig.migrationDelay;
+
+    // Everyone finished reading our outbox before the last barrier
+    c->outboxes[part->id].count = 0;
+    for (int n = part->firstNode; n < part->lastNode; n++)
+    {
+      hpf_step(&c->nodes[n], windowEnd);
+    }
+    pthread_barrier_wait(&c->barrier);
+
+    deliverMigrations(part);
+
+    int active = 0;
+    for (int n = part->firstNode; n < part->lastNode && !active; n++)
+    {
+      active = !nodeQuiescent(&c->nodes[n]);
+    }
+    c->partitionActive[part->id] = active;
+    pthread_barrier_wait(&c->barrier);
+
+    int anyActive = 0;
+    for (int p = 0; p < c->numThreads; p++)
+    {
+      anyActive |= c->partitionActive[p];
+    }
+
+    windowStart = windowEnd;
+    if (part->id == 0)
+      c->windows++;
+    if (!anyActive || windowStart >= MAX_QUANTA * 2)
+      break;
+  }
+
+  return NULL;
+}
+
+// Order-sensitive hash of every finish time, to compare runs with different thread counts
+static unsigned int scheduleChecksum(sim_node *nodes, int numNodes)
+{
+  unsigned int hash = 2166136261u;
+  for (int n = 0; n < numNodes; n++)
+  {
+    for (int i = 0; i < nodes[n].numProcesses; i++)
+    {
+      unsigned int bits;
+      memcpy(&bits, &nodes[n].processList[i].finishTime, sizeof(bits));
+      hash = (hash ^ bits) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+static void hpf_cluster(unsigned int seed)
+{
+  cluster c;
+  memset(&c, 0, sizeof(c));
+  c.numNodes = clusterConfig.numNodes;
+  c.numThreads = clusterConfig.numThreads;
+  c.seed = seed;
+  if (c.numThreads > c.numNodes)
+    c.numThreads = c.numNodes;
+
+  c.nodes = malloc(sizeof(sim_node) * c.numNodes);
+  c.outboxes = calloc(c.numThreads, sizeof(migration_list));
+  c.partitionActive = calloc(c.numThreads, sizeof(int));
+  partition *parts = calloc(c.numThreads, sizeof(partition));
+  pthread_t *threads = malloc(sizeof(pthread_t) * c.numThreads);
+
+  for (int p = 0; p < c.numThreads; p++)
+  {
+    parts[p].c = &c;
+    parts[p].id = p;
+    parts[p].firstNode = (int)((long)c.numNodes * p / c.numThreads);
+    parts[p].lastNode = (int)((long)c.numNodes * (p + 1) / c.numThreads);
+  }
+
+  printf("\n%s Cluster: %d nodes, %d threads, %d jobs/node, lookahead %d quanta\n",
+         policyNames[schedulerPolicy], c.numNodes, c.numThreads, clusterConfig.jobsPerNode,
+         clusterConfig.migrationDelay);
+
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+
+  pthread_barrier_init(&c.barrier, NULL, c.numThreads);
+  for (int p = 0; p < c.numThreads; p++)
+  {
+    pthread_create(&threads[p], NULL, clusterWorker, &parts[p]);
+  }
+  for (int p = 0; p < c.numThreads; p++)
+  {
+    pthread_join(threads[p], NULL);
+  }
+  pthread_barrier_destroy(&c.barrier);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double elapsed = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+  priority_stats schedulerStats = {0};
+  calculatePriorityStats(&schedulerStats, c.nodes, c.numNodes);
+  char algorithmName[64];
+  snprintf(algorithmName, sizeof(algorithmName), "%s Cluster", policyNames[schedulerPolicy]);
+  printPriorityStats(&schedulerStats, algorithmName);
+
+  long generated = 0, migrated = 0, dropped = 0, cutOff = 0;
+  for (int n = 0; n < c.numNodes; n++)
+  {
+    generated += c.nodes[n].numProcesses;
+    migrated += c.nodes[n].migratedIn;
+    dropped += c.nodes[n].droppedProcesses;
+    cutOff += c.nodes[n].cutOffProcesses;
+  }
+
+  printf("\n--- Cluster ---\n");
+  printf("Processes: %ld\n", generated);
+  printf("Migrated: %ld\n", migrated);
+  printf("Dropped (process table full): %ld\n", dropped);
+  if (hpf_workload.closedLoop)
+    printf("Cut off (arriving after quantum %d): %ld\n", MAX_QUANTA, cutOff);
+  printf("Windows: %d\n", c.windows);
+  printf("Schedule checksum: %08x\n", scheduleChecksum(c.nodes, c.numNodes));
+  printf("Wall time: %.3f s\n", elapsed);
+  if (timelineConfig.path != NULL)
+    writeTimeline(c.nodes, c.numNodes);
+
+  for (int n = 0; n < c.numNodes; n++)
+  {
+    freeNode(&c.nodes[n]);
+  }
+  for (int p = 0; p < c.numThreads; p++)
+  {
+    free(c.outboxes[p].items);
+    free(parts[p].inbox.items);
+  }
+  free(c.nodes);
+  free(c.outboxes);
+  free(c.partitionActive);
+  free(parts);
+  free(threads);
+}
+
+// Adaptive trials: Welford running mean / variance of one metric
+typedef struct running_stat
+{
+  long n;
+  double mean;
+  double m2;
+} running_stat;
+
+static void runningStatAdd(running_stat *r, double x)
+{
+  r->n++;
+  double delta = x - r->mean;
+  r->mean += delta / r->n;
+  r->m2 += delta * (x - r->mean);
+}
+
+// 95% confidence interval half-width (normal approximation)
+static double runningStatHalfWidth(running_stat *r)
+{
+  if (r->n < 2)
+    return INFINITY;
+  return 1.96 * sqrt(r->m2 / (r->n - 1) / r->n);
+}
+
+static int runningStatConverged(running_stat *r, double precision)
+{
+  double halfWidth = runningStatHalfWidth(r);
+  // A metric stuck at exactly 0 (e.g. nothing ever completes) has nothing left to resolve
+  if (halfWidth == 0)
+    return 1;
+  return halfWidth <= precision * fabs(r->mean);
+}
+
+// The averages only exist when something of that priority completed
+static int metricSample(stats *s, int metric, double *value)
+{
+  switch (metric)
+  {
+  case 0:
+    *value = s->avgTurnaroundTime;
+    return s->totalProcesses > 0;
+  case 1:
+    *value = s->avgWaitingTime;
+    return s->totalProcesses > 0;
+  case 2:
+    *value = s->avgResponseTime;
+    return s->totalProcesses > 0;
+  case 3:
+    *value = s->throughput;
+    return 1;
+  default:
+    *value = s->totalProcesses;
+    return 1;
+  }
+}
+
+// The worker pool lives for the whole run; each batch is handed to it by bumping generation
+typedef struct trial_batch
+{
+  unsigned int seed; // trial i runs with seed + i
+  int first;
+  int count;
+  int next;
+  int finished;
+  int generation;
+  int stopping;
+  priority_stats *results; // indexed within the batch
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+} trial_batch;
+
+// One reusable node per worker for the whole run, trials handed out one at a time
+static void *trialWorker(void *arg)
+{
+  trial_batch *batch = arg;
+  sim_node node;
+  initNode(&node, 0, generatedProcesses * PROCESS_POOL_FACTOR, 0);
+  int seen = 0;
+
+  pthread_mutex_lock(&batch->lock);
+  while (1)
+  {
+    while (batch->generation == seen && !batch->stopping)
+      pthread_cond_wait(&batch->work, &batch->lock);
+    if (batch->stopping)
+      break;
+    seen = batch->generation;
+
+    while (batch->next < batch->count)
+    {
+      int idx = batch->next++;
+      unsigned int seed = batch->seed + batch->first + idx;
+      pthread_mutex_unlock(&batch->lock);
+
+      resetNode(&node, seed);
+      generate_proc(&node, generatedProcesses);
+      scheduleArrivals(&node);
+      hpf_step(&node, MAX_QUANTA * 2);
+      calculatePriorityStats(&batch->results[idx], &node, 1);
+
+      pthread_mutex_lock(&batch->lock);
+      if (++batch->finished == batch->count)
+        pthread_cond_signal(&batch->done);
+    }
+  }
+  pthread_mutex_unlock(&batch->lock);
+
+  freeNode(&node);
+  return NULL;
+}
+
+static void hpf_adaptive(unsigned int seed)
+{
+  int numThreads = clusterConfig.numThreads;
+  running_stat metrics[5][NUM_METRICS]; // priorities 1-4, then overall
+  memset(metrics, 0, sizeof(metrics));
+
+  // Room for the largest batch: the first one (minTrials) or ADAPTIVE_BATCH
+  int maxBatch = adaptiveConfig.minTrials > ADAPTIVE_BATCH ? adaptiveConfig.minTrials : ADAPTIVE_BATCH;
+  if (maxBatch > adaptiveConfig.maxTrials)
+    maxBatch = adaptiveConfig.maxTrials;
+  priority_stats *results = malloc(sizeof(priority_stats) * maxBatch);
+  pthread_t *threads = malloc(sizeof(pthread_t) * numThreads);
+  int trials = 0;
+  int converged = 0;
+
+  trial_batch batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.seed = seed;
+  batch.results = results;
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.work, NULL);
+  pthread_cond_init(&batch.done, NULL);
+  for (int t = 0; t < numThreads; t++)
+  {
+    pthread_create(&threads[t], NULL, trialWorker, &batch);
+  }
+
+  printf("\n%s Adaptive Trials: target +/-%.1f%% (95%% CI), %d - %d trials, %d threads\n",
+         policyNames[schedulerPolicy], adaptiveConfig.precision * 100, adaptiveConfig.minTrials, adaptiveConfig.maxTrials, numThreads);
+
+  while (trials < adaptiveConfig.maxTrials && !converged)
+  {
+    pthread_mutex_lock(&batch.lock);
+    batch.first = trials;
+    batch.count = trials < adaptiveConfig.minTrials ? adaptiveConfig.minTrials : ADAPTIVE_BATCH;
+    if (batch.count > adaptiveConfig.maxTrials - trials)
+      batch.count = adaptiveConfig.maxTrials - trials;
+    batch.next = 0;
+    batch.finished = 0;
+    batch.generation++;
+    pthread_cond_broadcast(&batch.work);
+    while (batch.finished < batch.count)
+      pthread_cond_wait(&batch.done, &batch.lock);
+    pthread_mutex_unlock(&batch.lock);
+
+    // Merge in trial order so the estimates don't depend on thread timing
+    for (int i = 0; i < batch.count; i++)
+    {
+      for (int level = 0; level < 5; level++)
+      {
+        stats *s = level < 4 ? &results[i].priorityStats[level] : &results[i].overallStats;
+        for (int m = 0; m < NUM_METRICS; m++)
+        {
+          double value;
+          if (metricSample(s, m, &value))
+            runningStatAdd(&metrics[level][m], value);
+        }
+      }
+    }
+    trials += batch.count;
+
+    converged = 1;
+    for (int level = 0; level < 5 && converged; level++)
+    {
+      for (int m = 0; m < NUM_METRICS; m++)
+      {
+        if ((adaptiveConfig.metricMask & (1 << m)) &&
+            !runningStatConverged(&metrics[level][m], adaptiveConfig.precision))
+        {
+          converged = 0;
+          break;
+        }
+      }
+    }
+  }
+
+  pthread_mutex_lock(&batch.lock);
+  batch.stopping = 1;
+  pthread_cond_broadcast(&batch.work);
+  pthread_mutex_unlock(&batch.lock);
+  for (int t = 0; t < numThreads; t++)
+  {
+    pthread_join(threads[t], NULL);
+  }
+  pthread_mutex_destroy(&batch.lock);
+  pthread_cond_destroy(&batch.work);
+  pthread_cond_destroy(&batch.done);
+
+  printf("Trials: %d (%s)\n", trials, converged ? "converged" : "hit --max-trials");
+  printf("\n%-12s%-12s%-14s%-14s%-10s%-8s\n", "Priority", "Metric", "Mean", "+/- (95%)", "Rel.", "N");
+  for (int level = 0; level < 5; level++)
+  {
+    for (int m = 0; m < NUM_METRICS; m++)
+    {
+      if (!(adaptiveConfig.metricMask & (1 << m)))
+        continue;
+
+      running_stat *r = &metrics[level][m];
+      double halfWidth = runningStatHalfWidth(r);
+      char label[16];
+      if (level < 4)
+        snprintf(label, sizeof(label), "%d", level + 1);
+      else
+        snprintf(label, sizeof(label), "Overall");
+
+      if (r->n < 2)
+      {
+        printf("%-12s%-12s%-14s%-14s%-10s%-8ld\n", label, metricNames[m], "N/A", "N/A", "N/A", r->n);
+        continue;
+      }
+
+      char relative[16];
+      snprintf(relative, sizeof(relative), "%.1f%%", r->mean != 0 ? 100.0 * halfWidth / fabs(r->mean) : 0.0);
+      printf("%-12s%-12s%-14.3f%-14.3f%-10s%-8ld\n", label, metricNames[m], r->mean, halfWidth, relative, r->n);
+    }
+  }
+
+  free(results);
+  free(threads);
+}
+
+// "turnaround,response" -> metric bit mask, 0 if a name is unknown
+static int parseMetrics(const char *list)
+{
+  int mask = 0;
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer), "%s", list);
+
+  for (char *name = strtok(buffer, ","); name != NULL; name = strtok(NULL, ","))
+  {
+    int m = 0;
+    while (m < NUM_METRICS && strcmp(name, metricNames[m]) != 0)
+      m++;
+    if (m == NUM_METRICS)
+      return 0;
+    mask |= 1 << m;
+  }
+  return mask;
+}
+
+// "cap,wait,bucket" -> ADMISSION_* mask, 0 if a name is unknown
+static int parseAdmission(const char *list)
+{
+  int mask = 0;
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer), "%s", list);
+  char *save;
+  // strtok_r: server workers parse requests concurrently
+  for (char *name = strtok_r(buffer, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+  {
+    int a = 0;
+    while (a < NUM_ADMISSION_POLICIES && strcmp(name, admissionNames[a]) != 0)
+      a++;
+    if (a == NUM_ADMISSION_POLICIES)
+      return 0;
+    mask |= 1 << a;
+  }
+  return mask;
+}
+
+// One value for every priority, or four comma separated ones for priorities 1 - 4
+static int parsePerPriority(const char *list, float values[4])
+{
+  float v[4];
+  int n = sscanf(list, "%f,%f,%f,%f", &v[0], &v[1], &v[2], &v[3]);
+  if (n != 1 && n != 4)
+    return 0;
+  for (int i = 0; i < 4; i++)
+  {
+    values[i] = n == 1 ? v[0] : v[i];
+  }
+  return 1;
+}
+
+// Server mode (--serve=PATH): a pool of --threads warm workers, each with one node
+// allocated up front and reset between requests, serving Unix socket connections. A
+// request is one line of key=value pairs, the reply one line of JSON:
+//
+//    seed=42 processes=100 policy=cfs admission=cap,wait lock-protocol=inherit
+//    trace=/path/to/trace policy=hpf-np
+//
+// Keys left out take the server's command line values. A trace has one process per line,
+// "arrival runtime priority", '#' starts a comment. Closed-loop, I/O, lock, CFS and
+// admission thresholds are process-wide, so they are fixed when the server starts.
+//
+// A connection can send any number of requests. The accept thread polls the idle ones;
+// a worker serves one request and hands the connection back, so a client that keeps its
+// connection open between requests never ties up a worker.
+#define SERVE_ARENA_PROCESSES 4096
+#define SERVE_BACKLOG 64
+#define SERVE_CONNECTIONS 256
+#define SERVE_LINE 1024
+
+typedef struct serve_conn
+{
+  int fd; // -1 once closed
+  FILE *out;
+  int used; // bytes of buffer read but not served yet
+  char buffer[SERVE_LINE];
+} serve_conn;
+
+// Connections with a request to serve wait in `ready` for a worker. Served ones go to
+// `idle`, where the accept thread picks them up and polls them for the next request.
+typedef struct serve_queue
+{
+  serve_conn *ready[SERVE_CONNECTIONS];
+  int head;
+  int count;
+  serve_conn *idle[SERVE_CONNECTIONS];
+  int numIdle;
+  int stopping;
+  unsigned int seed; // for requests without seed=
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+} serve_queue;
+
+static volatile sig_atomic_t serveStop = 0;
+static int serveWakeFd = -1; // write end of the pipe the accept thread polls
+
+// Break the accept thread out of poll(). Safe from a signal handler.
+static void serveWake(void)
+{
+  ssize_t written = write(serveWakeFd, "!", 1);
+  (void)written; // a full pipe already wakes it
+}
+
+static void onServeSignal(int sig)
+{
+  (void)sig;
+  serveStop = 1;
+  serveWake();
+}
+
+// Add every process of a trace file, -1 if it can't be read or a line doesn't parse
+static int loadTrace(sim_node *node, const char *path)
+{
+  FILE *trace = fopen(path, "r");
+  if (trace == NULL)
+    return -1;
+
+  char line[256];
+  int count = 0;
+  while (fgets(line, sizeof(line), trace) != NULL)
+  {
+    float arrivalTime, runTime;
+    int priority;
+    char *comment = strchr(line, '#');
+    if (comment != NULL)
+      *comment = '\0';
+    if (strspn(line, " \t\r\n") == strlen(line))
+      continue;
+
+    if (sscanf(line, "%f %f %d", &arrivalTime, &runTime, &priority) != 3 ||
+        addProcess(node, arrivalTime, runTime, priority) == NULL)
+    {
+      fclose(trace);
+      return -1;
+    }
+    count++;
+  }
+  fclose(trace);
+  return count;
+}
+
+static void writeStatsJson(FILE *out, stats *st)
+{
+  fprintf(out,
+          "{\"completed\":%d,\"rejected\":%d,\"deferred\":%d,\"turnaround\":%.3f,\"waiting\":%.3f,"
+          "\"p99Waiting\":%.3f,\"response\":%.3f,\"ioWait\":%.3f,\"lockBlocked\":%.3f,\"inversion\":%.3f,"
+          "\"throughput\":%.4f}",
+          st->totalProcesses, st->rejectedProcesses, st->deferredProcesses, st->avgTurnaroundTime,
+          st->avgWaitingTime, st->p99WaitingTime, st->avgResponseTime, st->avgIoWaitTime,
+          st->avgLockBlockedTime, st->avgInversionTime, st->throughput);
+}
+
+// Run one request line on the worker's node and write the reply
+static void serveRequest(sim_node *node, char *line, unsigned int seed, FILE *out)
+{
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+
+  int count = generatedProcesses;
+  int policy = schedulerPolicy;
+  int admission = hpf_admission.policies;
+  int lockProtocol = hpf_locks.protocol;
+  const char *trace = NULL;
+  const char *error = NULL;
+
+  char *save;
+  for (char *key = strtok_r(line, " \t\r\n", &save); key != NULL && error == NULL;
+       key = strtok_r(NULL, " \t\r\n", &save))
+  {
+    char *value = strchr(key, '=');
+    if (value == NULL)
+    {
+      error = "expected key=value";
+      break;
+    }
+    *value++ = '\0';
+
+    if (strcmp(key, "seed") == 0)
+      seed = strtoul(value, NULL, 10);
+    else if (strcmp(key, "processes") == 0)
+      count = atoi(value);
+    else if (strcmp(key, "trace") == 0)
+      trace = value;
+    else if (strcmp(key, "policy") == 0 && strcmp(value, "hpf") == 0)
+      policy = HPF_POLICY_PREEMPTIVE;
+    else if (strcmp(key, "policy") == 0 && strcmp(value, "hpf-np") == 0)
+      policy = HPF_POLICY_NON_PREEMPTIVE;
+    else if (strcmp(key, "policy") == 0 && strcmp(value, "cfs") == 0)
+      policy = HPF_POLICY_CFS;
+    else if (strcmp(key, "admission") == 0 && strcmp(value, "none") == 0)
+      admission = 0;
+    else if (strcmp(key, "admission") == 0 && (admission = parseAdmission(value)) != 0)
+      continue;
+    else if (strcmp(key, "lock-protocol") == 0 && strcmp(value, "none") == 0)
+      lockProtocol = LOCK_PROTOCOL_NONE;
+    else if (strcmp(key, "lock-protocol") == 0 && strcmp(value, "inherit") == 0)
+      lockProtocol = LOCK_PROTOCOL_INHERIT;
+    else if (strcmp(key, "lock-protocol") == 0 && strcmp(value, "ceiling") == 0)
+      lockProtocol = LOCK_PROTOCOL_CEILING;
+    else
+      error = "unknown key or value";
+  }
+
+  if (error == NULL && (count < 1 || count > node->maxProcesses))
+    error = "processes out of range";
+
+  if (error == NULL)
+  {
+    resetNode(node, seed);
+    node->policy = policy;
+    node->admissionPolicies = admission;
+    node->lockProtocol = lockProtocol;
+    if (trace == NULL)
+      generate_proc(node, count);
+    else if (loadTrace(node, trace) < 0)
+      error = "cannot load trace";
+  }
+
+  if (error != NULL)
+  {
+    fprintf(out, "{\"ok\":false,\"error\":\"%s\"}\n", error);
+    return;
+  }
+
+  scheduleArrivals(node);
+  hpf_step(node, MAX_QUANTA * 2);
+
+  priority_stats ps = {0};
+  calculatePriorityStats(&ps, node, 1);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double micros = (end.tv_sec - begin.tv_sec) * 1e6 + (end.tv_nsec - begin.tv_nsec) / 1e3;
+
+  fprintf(out, "{\"ok\":true,\"policy\":\"%s\",\"processes\":%d,\"time\":%d,\"preemptions\":%d,\"micros\":%.1f,",
+          policyNames[policy], node->numProcesses, node->currentTime, node->totalPreemptions, micros);
+  fprintf(out, "\"priorities\":[");
+  for (int priority = 0; priority < 4; priority++)
+  {
+    if (priority > 0)
+      fputc(',', out);
+    writeStatsJson(out, &ps.priorityStats[priority]);
+  }
+  fprintf(out, "],\"overall\":");
+  writeStatsJson(out, &ps.overallStats);
+  fprintf(out, "}\n");
+}
+
+// Serve the next request buffered on conn, reading more of it first if no full line is
+// there yet. 0 once the connection is done: the client hung up or the reply can't be sent.
+static int serveNext(sim_node *node, serve_conn *conn, unsigned int seed)
+{
+  int last = 0;
+  char *newline = memchr(conn->buffer, '\n', conn->used);
+  if (newline == NULL)
+  {
+    if (conn->used == SERVE_LINE - 1)
+    {
+      fprintf(conn->out, "{\"ok\":false,\"error\":\"request too long\"}\n");
+      fflush(conn->out);
+      return 0;
+    }
+    ssize_t n = read(conn->fd, conn->buffer + conn->used, SERVE_LINE - 1 - conn->used);
+    if (n <= 0 && conn->used == 0)
+      return 0;
+    if (n <= 0)
+    {
+      // Hung up after a last request without a newline
+      newline = conn->buffer + conn->used;
+      last = 1;
+    }
+    else
+    {
+      conn->used += n;
+      newline = memchr(conn->buffer, '\n', conn->used);
+      if (newline == NULL)
+        return 1; // the rest of the line is still on its way
+    }
+  }
+
+  *newline = '\0';
+  if (strspn(conn->buffer, " \t\r") != strlen(conn->buffer))
+  {
+    serveRequest(node, conn->buffer, seed, conn->out);
+    if (fflush(conn->out) != 0)
+      return 0;
+  }
+  if (last)
+    return 0;
+  conn->used -= newline + 1 - conn->buffer;
+  memmove(conn->buffer, newline + 1, conn->used);
+  return 1;
+}
+
+static void *serveWorker(void *arg)
+{
+  serve_queue *queue = arg;
+  sim_node node;
+  initNode(&node, 0, SERVE_ARENA_PROCESSES, 0);
+
+  while (1)
+  {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->stopping)
+      pthread_cond_wait(&queue->work, &queue->lock);
+    if (queue->count == 0)
+    {
+      pthread_mutex_unlock(&queue->lock);
+      break;
+    }
+    serve_conn *conn = queue->ready[queue->head];
+    queue->head = (queue->head + 1) % SERVE_CONNECTIONS;
+    queue->count--;
+    pthread_mutex_unlock(&queue->lock);
+
+    if (!serveNext(&node, conn, queue->seed))
+    {
+      fclose(conn->out);
+      close(conn->fd);
+      conn->fd = -1;
+    }
+
+    // A request already buffered goes straight back in line; otherwise the accept thread
+    // waits for the client to send one
+    pthread_mutex_lock(&queue->lock);
+    if (conn->fd >= 0 && memchr(conn->buffer, '\n', conn->used) != NULL)
+    {
+      queue->ready[(queue->head + queue->count) % SERVE_CONNECTIONS] = conn;
+      queue->count++;
+      pthread_cond_signal(&queue->work);
+    }
+    else
+    {
+      queue->idle[queue->numIdle++] = conn;
+      serveWake();
+    }
+    pthread_mutex_unlock(&queue->lock);
+  }
+
+  freeNode(&node);
+  return NULL;
+}
+
+// Accept and poll until SIGINT / SIGTERM, then serve the requests already read and hang up.
+// Requests without seed= use `seed`.
+static int hpf_serve(const char *path, unsigned int seed)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return 1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int wake[2];
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(listener, SERVE_BACKLOG) < 0 || pipe(wake) < 0)
+  {
+    perror("serve");
+    return 1;
+  }
+  fcntl(wake[1], F_SETFL, O_NONBLOCK);
+  serveWakeFd = wake[1];
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onServeSignal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN); // a client hanging up mid-reply is the worker's problem, not ours
+
+  serve_queue queue;
+  memset(&queue, 0, sizeof(queue));
+  queue.seed = seed;
+  pthread_mutex_init(&queue.lock, NULL);
+  pthread_cond_init(&queue.work, NULL);
+
+  serve_conn *conns = malloc(sizeof(serve_conn) * SERVE_CONNECTIONS);
+  serve_conn *freeConns[SERVE_CONNECTIONS];
+  serve_conn *polled[SERVE_CONNECTIONS]; // idle connections this thread waits on
+  int numFree = 0;
+  int numPolled = 0;
+  for (int c = SERVE_CONNECTIONS - 1; c >= 0; c--)
+  {
+    conns[c].fd = -1;
+    freeConns[numFree++] = &conns[c];
+  }
+
+  // Workers inherit the signal mask, so with SIGINT / SIGTERM blocked while they start,
+  // the signals always land on this thread and interrupt its poll()
+  sigset_t signals, previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+  int numThreads = clusterConfig.numThreads;
+  pthread_t *threads = malloc(sizeof(pthread_t) * numThreads);
+  for (int t = 0; t < numThreads; t++)
+  {
+    pthread_create(&threads[t], NULL, serveWorker, &queue);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  printf("Serving on %s with %d worker%s\n", path, numThreads, numThreads > 1 ? "s" : "");
+  fflush(stdout);
+
+  struct pollfd fds[SERVE_CONNECTIONS + 2];
+  while (!serveStop)
+  {
+    fds[0].fd = listener;
+    fds[1].fd = wake[0];
+    for (int i = 0; i < numPolled; i++)
+    {
+      fds[2 + i].fd = polled[i]->fd;
+    }
+    for (int i = 0; i < numPolled + 2; i++)
+    {
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    if (poll(fds, numPolled + 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
+      break;
+    }
+
+    // Connections with a request (or a hang-up) go to the workers, served ones come back
+    pthread_mutex_lock(&queue.lock);
+    int kept = 0;
+    for (int i = 0; i < numPolled; i++)
+    {
+      if (fds[2 + i].revents == 0)
+      {
+        polled[kept++] = polled[i];
+        continue;
+      }
+      queue.ready[(queue.head + queue.count) % SERVE_CONNECTIONS] = polled[i];
+      queue.count++;
+      pthread_cond_signal(&queue.work);
+    }
+    numPolled = kept;
+    if (fds[1].revents != 0)
+    {
+      char drain[64];
+      if (read(wake[0], drain, sizeof(drain)) < 0)
+        perror("read");
+      for (int i = 0; i < queue.numIdle; i++)
+      {
+        if (queue.idle[i]->fd < 0)
+          freeConns[numFree++] = queue.idle[i];
+        else
+          polled[numPolled++] = queue.idle[i];
+      }
+      queue.numIdle = 0;
+    }
+    pthread_mutex_unlock(&queue.lock);
+
+    if (fds[0].revents == 0)
+      continue;
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("accept");
+      break;
+    }
+    int outFd = numFree > 0 ? dup(fd) : -1;
+    FILE *out = outFd >= 0 ? fdopen(outFd, "w") : NULL;
+    if (out == NULL)
+    {
+      const char *busy = "{\"ok\":false,\"error\":\"server busy\"}\n";
+      if (write(fd, busy, strlen(busy)) < 0)
+        perror("write");
+      if (outFd >= 0)
+        close(outFd);
+      close(fd);
+      continue;
+    }
+    serve_conn *conn = freeConns[--numFree];
+    conn->fd = fd;
+    conn->out = out;
+    conn->used = 0;
+    polled[numPolled++] = conn;
   }
 
-  calculatePriorityStats(&schedulerStats);
-  printPriorityStats(&schedulerStats, "HPF Preemptive");
+  close(listener);
+  unlink(path);
+
+  pthread_mutex_lock(&queue.lock);
+  queue.stopping = 1;
+  pthread_cond_broadcast(&queue.work);
+  pthread_mutex_unlock(&queue.lock);
+  for (int t = 0; t < numThreads; t++)
+  {
+    pthread_join(threads[t], NULL);
+  }
+
+  for (int c = 0; c < SERVE_CONNECTIONS; c++)
+  {
+    if (conns[c].fd < 0)
+      continue;
+    fclose(conns[c].out);
+    close(conns[c].fd);
+  }
+  serveWakeFd = -1;
+  close(wake[0]);
+  close(wake[1]);
+  free(conns);
+  free(threads);
+  pthread_mutex_destroy(&queue.lock);
+  pthread_cond_destroy(&queue.work);
+  return 0;
+}
+
+static void printUsage(const char *prog)
+{
+  printf("Usage: %s [--seed=N] [--closed-loop] [--resubmits=N] [--think=MIN:MAX] [--spawn=PROB:MAXCHILDREN]\n", prog);
+  printf("       [--nodes=N] [--threads=N] [--jobs-per-node=N] [--migration-delay=Q] [--migrate=PROB]\n");
+  printf("       [--io] [--bursts=MAXCPUBURSTS] [--io-service=MIN:MAX] [--io-devices=N] [--quiet]\n");
+  printf("       [--adaptive] [--precision=REL] [--min-trials=N] [--max-trials=N] [--metrics=a,b,...]\n");
+  printf("       [--locks=N] [--lock-use=PROB] [--lock-at=FRACTION] [--lock-hold=Q]\n");
+  printf("       [--policy=hpf|hpf-np|cfs] [--target-latency=Q] [--min-granularity=Q] [--cfs-compare] [--cfs-bench=N]\n");
+  printf("       [--processes=N] [--admission=cap,wait,bucket] [--queue-cap=N[,N,N,N]] [--max-wait=Q[,Q,Q,Q]]\n");
+  printf("       [--token-rate=R[,R,R,R]] [--token-burst=N[,N,N,N]] [--admission-compare]\n");
+  printf("       [--serve=SOCKETPATH] [--timeline=FILE] [--timeline-binary]\n");
 }
 
-int main()
+int main(int argc, char *argv[])
 {
-  srand(time(NULL));
+  unsigned int seed = time(NULL);
+  int verbose = 1;
+  int cfsCompare = 0;
+  int cfsBench = 0;
+  int admissionCompare = 0;
+  const char *servePath = NULL;
+  float queueCap[4];
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--seed=", 7) == 0)
+      seed = strtoul(argv[i] + 7, NULL, 10);
+    else if (strcmp(argv[i], "--closed-loop") == 0)
+      hpf_workload.closedLoop = 1;
+    else if (strncmp(argv[i], "--resubmits=", 12) == 0)
+      hpf_workload.maxResubmits = atoi(argv[i] + 12);
+    else if (strncmp(argv[i], "--think=", 8) == 0 &&
+             sscanf(argv[i] + 8, "%f:%f", &hpf_workload.minThinkTime, &hpf_workload.maxThinkTime) == 2)
+      continue;
+    else if (strncmp(argv[i], "--spawn=", 8) == 0 &&
+             sscanf(argv[i] + 8, "%f:%d", &hpf_workload.spawnProbability, &hpf_workload.maxChildren) == 2)
+      continue;
+    else if (strncmp(argv[i], "--nodes=", 8) == 0)
+      clusterConfig.numNodes = atoi(argv[i] + 8);
+    else if (strncmp(argv[i], "--threads=", 10) == 0)
+      clusterConfig.numThreads = atoi(argv[i] + 10);
+    else if (strncmp(argv[i], "--jobs-per-node=", 16) == 0)
+      clusterConfig.jobsPerNode = atoi(argv[i] + 16);
+    else if (strncmp(argv[i], "--migration-delay=", 18) == 0)
+      clusterConfig.migrationDelay = atoi(argv[i] + 18);
+    else if (strncmp(argv[i], "--migrate=", 10) == 0)
+      clusterConfig.migrateProbability = atof(argv[i] + 10);
+    else if (strcmp(argv[i], "--io") == 0)
+      hpf_io.enabled = 1;
+    else if (strncmp(argv[i], "--bursts=", 9) == 0)
+      hpf_io.maxCpuBursts = atoi(argv[i] + 9);
+    else if (strncmp(argv[i], "--io-service=", 13) == 0 &&
+             sscanf(argv[i] + 13, "%f:%f", &hpf_io.minServiceTime, &hpf_io.maxServiceTime) == 2)
+      continue;
+    else if (strncmp(argv[i], "--io-devices=", 13) == 0)
+      hpf_io.numDevices = atoi(argv[i] + 13);
+    else if (strcmp(argv[i], "--quiet") == 0)
+      verbose = 0;
+    else if (strncmp(argv[i], "--locks=", 8) == 0)
+      hpf_locks.numLocks = atoi(argv[i] + 8);
+    else if (strncmp(argv[i], "--lock-use=", 11) == 0)
+      hpf_locks.useProbability = atof(argv[i] + 11);
+    else if (strncmp(argv[i], "--lock-at=", 10) == 0)
+      hpf_locks.acquireAt = atof(argv[i] + 10);
+    else if (strncmp(argv[i], "--lock-hold=", 12) == 0)
+      hpf_locks.holdTime = atof(argv[i] + 12);
+    else if (strcmp(argv[i], "--policy=hpf") == 0)
+      schedulerPolicy = HPF_POLICY_PREEMPTIVE;
+    else if (strcmp(argv[i], "--policy=hpf-np") == 0)
+      schedulerPolicy = HPF_POLICY_NON_PREEMPTIVE;
+    else if (strcmp(argv[i], "--policy=cfs") == 0)
+      schedulerPolicy = HPF_POLICY_CFS;
+    else if (strncmp(argv[i], "--target-latency=", 17) == 0)
+      hpf_cfs.targetLatency = atof(argv[i] + 17);
+    else if (strncmp(argv[i], "--min-granularity=", 18) == 0)
+      hpf_cfs.minGranularity = atof(argv[i] + 18);
+    else if (strcmp(argv[i], "--cfs-compare") == 0)
+      cfsCompare = 1;
+    else if (strncmp(argv[i], "--cfs-bench=", 12) == 0)
+      cfsBench = atoi(argv[i] + 12);
+    else if (strncmp(argv[i], "--processes=", 12) == 0)
+      generatedProcesses = atoi(argv[i] + 12);
+    else if (strncmp(argv[i], "--admission=", 12) == 0 &&
+             (hpf_admission.policies = parseAdmission(argv[i] + 12)) != 0)
+      continue;
+    else if (strncmp(argv[i], "--queue-cap=", 12) == 0 && parsePerPriority(argv[i] + 12, queueCap))
+    {
+      for (int p = 0; p < 4; p++)
+        hpf_admission.queueCap[p] = (int)queueCap[p];
+    }
+    else if (strncmp(argv[i], "--max-wait=", 11) == 0 && parsePerPriority(argv[i] + 11, hpf_admission.maxWait))
+      continue;
+    else if (strncmp(argv[i], "--token-rate=", 13) == 0 && parsePerPriority(argv[i] + 13, hpf_admission.tokenRate))
+      continue;
+    else if (strncmp(argv[i], "--token-burst=", 14) == 0 &&
+             parsePerPriority(argv[i] + 14, hpf_admission.bucketSize))
+      continue;
+    else if (strcmp(argv[i], "--admission-compare") == 0)
+      admissionCompare = 1;
+    else if (strncmp(argv[i], "--serve=", 8) == 0)
+      servePath = argv[i] + 8;
+    else if (strncmp(argv[i], "--timeline=", 11) == 0)
+      timelineConfig.path = argv[i] + 11;
+    else if (strcmp(argv[i], "--timeline-binary") == 0)
+      timelineConfig.binary = 1;
+    else if (strcmp(argv[i], "--adaptive") == 0)
+      adaptiveConfig.enabled = 1;
+    else if (strncmp(argv[i], "--precision=", 12) == 0)
+      adaptiveConfig.precision = atof(argv[i] + 12);
+    else if (strncmp(argv[i], "--min-trials=", 13) == 0)
+      adaptiveConfig.minTrials = atoi(argv[i] + 13);
+    else if (strncmp(argv[i], "--max-trials=", 13) == 0)
+      adaptiveConfig.maxTrials = atoi(argv[i] + 13);
+    else if (strncmp(argv[i], "--metrics=", 10) == 0 &&
+             (adaptiveConfig.metricMask = parseMetrics(argv[i] + 10)) != 0)
+      continue;
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Clamp the flags the same way every node clamps its copy, so the reports show what runs
+  sim_config clamped;
+  loadConfig(&clamped);
+  hpf_workload = clamped.workload;
+  hpf_io = clamped.io;
+  hpf_locks = clamped.locks;
+  hpf_cfs = clamped.cfs;
+  hpf_admission = clamped.admission;
+  if (clusterConfig.numNodes < 1)
+    clusterConfig.numNodes = 1;
+  if (clusterConfig.numThreads < 1)
+    clusterConfig.numThreads = 1;
+  if (clusterConfig.jobsPerNode < 1)
+    clusterConfig.jobsPerNode = 1;
+  // The lookahead has to be at least one quantum for the windows to make progress
+  if (clusterConfig.migrationDelay < 1)
+    clusterConfig.migrationDelay = 1;
+  if (adaptiveConfig.minTrials < 2)
+    adaptiveConfig.minTrials = 2;
+  if (adaptiveConfig.maxTrials < adaptiveConfig.minTrials)
+    adaptiveConfig.maxTrials = adaptiveConfig.minTrials;
+  if (generatedProcesses < 1)
+    generatedProcesses = 1;
+
+  if (servePath != NULL)
+    return hpf_serve(servePath, seed);
+
+  if (cfsBench > 0)
+  {
+    cfsBenchmark(cfsBench < 1000 ? 1000 : cfsBench);
+    return 0;
+  }
+
+  if (cfsCompare)
+  {
+    hpf_cfs_comparison(seed, verbose);
+    return 0;
+  }
+
+  if (admissionCompare)
+  {
+    hpf_admission_comparison(seed, verbose);
+    return 0;
+  }
+
+  if (clusterConfig.numNodes > 1)
+  {
+    hpf_cluster(seed);
+    return 0;
+  }
+
+  if (adaptiveConfig.enabled)
+  {
+    hpf_adaptive(seed);
+    return 0;
+  }
 
-  generate_proc();
-  hpf_preemptive();
+  if (hpf_io.enabled)
+  {
+    hpf_io_comparison(seed, verbose);
+    return 0;
+  }
+
+  if (hpf_locks.numLocks > 0)
+  {
+    hpf_lock_comparison(seed, verbose);
+    return 0;
+  }
+
+  sim_node node;
+  initNode(&node, 0, generatedProcesses * PROCESS_POOL_FACTOR, seed);
+  node.verbose = verbose;
+  if (timelineConfig.path != NULL)
+    timelineOpen(&node);
 
+  generate_proc(&node, generatedProcesses);
+  hpf_run(&node, policyNames[schedulerPolicy]);
+  if (timelineConfig.path != NULL)
+    writeTimeline(&node, 1);
+
+  freeNode(&node);
   return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,236 @@
+/*****
+ * HPF scheduler simulator -- library interface
+ *
+ * The simulator in hpf_pre.c can be built as a library instead of the CLI:
+ *
+ *    cc -O2 -pthread -DHPF_NO_MAIN -c hpf_pre.c && ar rcs libhpf.a hpf_pre.o
+ *
+ * and linked with -lhpf -pthread -lm. Only the hpf_sim_* functions and the config globals
+ * declared here are exported; everything else in hpf_pre.c is static. A simulation is
+ * configured once, fed processes (or a generated workload), run, and its results read back
+ * as plain structs:
+ *
+ *    hpf_config config = {HPF_POLICY_PREEMPTIVE, 256, 42};
+ *    hpf_sim *sim = hpf_sim_create(&config);
+ *    hpf_sim_add_process(sim, 0.5f, 3.0f, 1);
+ *    hpf_sim_run(sim);
+ *    hpf_sim_stats(sim, &stats);
+ *    const hpf_process *procs = hpf_sim_processes(sim, &count);
+ *    hpf_sim_reset(sim, 43); // reuse the same allocations for the next run
+ *
+ * A hpf_sim is not thread safe, but separate ones can run on separate threads. The
+ * closed-loop (hpf_workload), I/O (hpf_io), lock (hpf_locks), CFS (hpf_cfs) and admission
+ * (hpf_admission) globals are defaults: hpf_sim_create copies them into the simulation and
+ * clamps the copy (e.g. hpf_io.maxCpuBursts to (MAX_BURSTS + 1) / 2, hpf_locks.numLocks to
+ * 0..8). The library never writes them. Changing them only affects simulations created
+ * afterwards; a reset keeps the copy the simulation already has.
+ *
+ * Written by: Raphael Kusuma -- 10/11/2025
+ */
+#ifndef HPF_SIM_H
+#define HPF_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CPU and I/O bursts per process: CPU, I/O, CPU, ..., CPU
+#define MAX_BURSTS 9
+
+// A simulated process. The library hands these out read-only (hpf_sim_processes).
+typedef struct hpf_process
+{
+  int processId;
+  int parentId; // -1 for processes created by generate_proc()
+  char processName;
+  float arrivalTime;
+  float expectedRunTime;
+  float remainingTime;
+  int priority;
+  // When a process starts and finished
+  float startTime;
+  float finishTime;
+
+  // It is equal to the sum total of Waiting time and Execution time.
+  float turnaroundTime;
+  float waitingTime; // time spent in a ready queue, summed each time it is picked
+  float readySince;  // when it last became ready
+  int timesPreempted;
+
+  // Bursts alternate CPU (even index) and I/O (odd index), always starting and ending on CPU
+  float bursts[MAX_BURSTS];
+  int numBursts;
+  int burstIndex;
+  float burstRemaining; // CPU left in the current CPU burst
+  float wakeupTime;     // when the outstanding I/O request completes
+  float ioWaitTime;     // total time spent blocked on I/O (queueing + service)
+
+  // Shared lock use: take lock `lockId` once lockAcquireAt quanta of CPU have been used,
+  // give it back at lockReleaseAt. effectivePriority is what the scheduler sees, raised
+  // above priority by inheritance / ceiling while the lock is held.
+  int lockId; // -1 if the process uses no lock
+  int lockState;
+  float lockAcquireAt;
+  float lockReleaseAt;
+  int effectivePriority;
+  float lockBlockedSince;
+  float lockBlockedTime; // total time waiting for the lock
+  float inversionTime;   // part of that during which the CPU ran at a lower effective priority
+
+  // CFS: weighted CPU time and the intrusive red-black tree links (see hpf_pre.c)
+  double vruntime;
+  int weight; // weight while queued in the tree
+  struct hpf_process *rbLeft;
+  struct hpf_process *rbRight;
+  struct hpf_process *rbParent;
+  int rbRed;
+
+  // Admission control: the verdict on its last arrival (ADMIT_*) and how often it was
+  // deferred; a deferred process keeps its arrivalTime, so the deferral counts as waiting
+  int admission;
+  int timesDeferred;
+
+  // Closed loop: how many more times this client resubmits after completing
+  int resubmitsLeft;
+  // Intrusive link for the timing wheel slot lists, and the tick it is due on
+  struct hpf_process *nextTimer;
+  int wheelTick;
+} hpf_process;
+
+// Stats
+typedef struct hpf_stats
+{
+  float avgTurnaroundTime;
+  float avgWaitingTime;
+  float avgResponseTime;
+  float avgIoWaitTime;
+  float avgLockBlockedTime;
+  float avgInversionTime;
+  float maxInversionTime;
+  float p99WaitingTime;
+  float throughput;
+
+  int totalProcesses;
+  int rejectedProcesses; // turned away by admission control, never ran
+  int deferredProcesses; // held back at least once (may have been rejected later)
+} hpf_stats;
+
+// Per-priority statistics structure
+typedef struct hpf_priority_stats
+{
+  hpf_stats priorityStats[4]; // Statistics for each priority level (1-4)
+  hpf_stats overallStats;     // Overall statistics across all priorities
+} hpf_priority_stats;
+
+// Closed-loop workload knobs, all off by default (open loop, original behaviour)
+typedef struct hpf_workload_config
+{
+  int closedLoop;
+  int maxResubmits;       // resubmissions per generated client
+  float minThinkTime;     // think time before a resubmission / child arrival
+  float maxThinkTime;
+  float spawnProbability; // chance a completing process spawns children
+  int maxChildren;        // 1 - maxChildren children per spawn
+} hpf_workload_config;
+
+// I/O mode knobs
+typedef struct hpf_io_config
+{
+  int enabled;
+  int maxCpuBursts;     // a process gets 1 - maxCpuBursts CPU bursts, with I/O in between
+  float minServiceTime; // device time per I/O request
+  float maxServiceTime;
+  int numDevices;
+} hpf_io_config;
+
+#define LOCK_PROTOCOL_NONE 0
+#define LOCK_PROTOCOL_INHERIT 1
+#define LOCK_PROTOCOL_CEILING 2
+
+// Shared lock knobs (0 locks = independent processes)
+typedef struct hpf_lock_config
+{
+  int numLocks;
+  int protocol;         // LOCK_PROTOCOL_*, default for new simulations
+  float useProbability; // chance a process needs one of the locks
+  float acquireAt;      // fraction of its CPU time a process runs before taking the lock
+  float holdTime;       // quanta of CPU it then holds the lock for
+} hpf_lock_config;
+
+// Completely fair policy knobs, in quanta
+typedef struct hpf_cfs_config
+{
+  float targetLatency;  // every runnable process should run once within this period
+  float minGranularity; // but no slice is shorter than this
+} hpf_cfs_config;
+
+// process.admission
+#define ADMIT_ACCEPT 0
+#define ADMIT_REJECT 1
+#define ADMIT_DEFER 2
+
+// Admission policies, checked in this order when a process arrives
+#define ADMISSION_QUEUE_CAP 1    // reject while queueCap processes of its priority are runnable
+#define ADMISSION_EST_WAIT 2     // reject when the work queued ahead of it exceeds maxWait
+#define ADMISSION_TOKEN_BUCKET 4 // defer until its priority's bucket has a token
+#define NUM_ADMISSION_POLICIES 3
+
+// Admission control knobs, per priority 1 - 4. A 0 threshold leaves that priority alone.
+typedef struct hpf_admission_config
+{
+  int policies; // ADMISSION_* bits, default for new simulations; 0 admits everything
+  int queueCap[4];
+  float maxWait[4];    // quanta
+  float tokenRate[4];  // tokens per quantum
+  float bucketSize[4]; // burst allowance; buckets start full
+} hpf_admission_config;
+
+extern hpf_workload_config hpf_workload;
+extern hpf_io_config hpf_io;
+extern hpf_lock_config hpf_locks;
+extern hpf_cfs_config hpf_cfs;
+extern hpf_admission_config hpf_admission;
+
+#define HPF_POLICY_PREEMPTIVE 0
+#define HPF_POLICY_NON_PREEMPTIVE 1
+#define HPF_POLICY_CFS 2 // not HPF at all: weighted fair share, for comparison
+
+typedef struct hpf_config
+{
+  int policy;        // HPF_POLICY_*
+  int maxProcesses;  // process table size: generated/added processes plus closed-loop follow-ups
+  unsigned int seed; // for hpf_sim_generate() and closed-loop / I/O randomness
+  int lockProtocol;  // LOCK_PROTOCOL_*, used when hpf_locks.numLocks > 0
+  int admissionPolicies; // ADMISSION_* bits, thresholds from hpf_admission
+} hpf_config;
+
+typedef struct hpf_sim hpf_sim;
+
+// NULL if the allocation fails
+hpf_sim *hpf_sim_create(const hpf_config *config);
+void hpf_sim_destroy(hpf_sim *sim);
+
+// Drop the workload and results, keep the allocations
+void hpf_sim_reset(hpf_sim *sim, unsigned int seed);
+
+// Replace the workload with `count` random processes, like the CLI does. Returns how many fit.
+int hpf_sim_generate(hpf_sim *sim, int count);
+
+// Add one process; processes arriving in the same quantum are queued in the order added.
+// Returns its processId, or -1 if the table is full or the priority isn't 1 - 4.
+int hpf_sim_add_process(hpf_sim *sim, float arrivalTime, float runTime, int priority);
+
+// Simulate until every process is done or MAX_QUANTA * 2. Returns the final time in quanta,
+// or -1 if the simulation already ran: hpf_sim_reset it before running it again.
+int hpf_sim_run(hpf_sim *sim);
+
+void hpf_sim_stats(hpf_sim *sim, hpf_priority_stats *out);
+
+// Zero-copy view of the process table, valid until the next reset / generate / destroy
+const hpf_process *hpf_sim_processes(hpf_sim *sim, int *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif